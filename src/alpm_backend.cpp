@@ -0,0 +1,83 @@
+#include "alpm_backend.h"
+#include <QDebug>
+#include <alpm.h>
+
+AlpmBackend::AlpmBackend(const QString& rootDir, const QString& dbPath, const QStringList& syncRepos,
+                         const QStringList& ignorePkg, const QStringList& ignoreGroup)
+    : rootDir(rootDir)
+    , dbPath(dbPath)
+    , syncRepos(syncRepos)
+    , ignorePkg(ignorePkg)
+    , ignoreGroup(ignoreGroup)
+{
+}
+
+AlpmBackend::~AlpmBackend() {
+    close();
+}
+
+bool AlpmBackend::open() {
+    if (handle) {
+        return true;
+    }
+
+    alpm_errno_t err = ALPM_ERR_OK;
+    handle = alpm_initialize(rootDir.toLocal8Bit().constData(), dbPath.toLocal8Bit().constData(), &err);
+    if (!handle) {
+        qWarning() << "libalpm initialization failed:" << alpm_strerror(err);
+        return false;
+    }
+
+    for (const QString& repo : syncRepos) {
+        if (!alpm_register_syncdb(handle, repo.toUtf8().constData(), ALPM_SIG_USE_DEFAULT)) {
+            qWarning() << "libalpm could not register sync database" << repo << ":"
+                       << alpm_strerror(alpm_errno(handle));
+        }
+    }
+    for (const QString& pkg : ignorePkg) {
+        alpm_option_add_ignorepkg(handle, pkg.toUtf8().constData());
+    }
+    for (const QString& group : ignoreGroup) {
+        alpm_option_add_ignoregroup(handle, group.toUtf8().constData());
+    }
+    return true;
+}
+
+bool AlpmBackend::reload() {
+    // libalpm caches package lists per handle, so changes written by another
+    // pacman process only become visible through a fresh handle
+    close();
+    return open();
+}
+
+void AlpmBackend::close() {
+    if (handle) {
+        alpm_release(handle);
+        handle = nullptr;
+    }
+}
+
+QList<PackageUpdate> AlpmBackend::queryUpdates() {
+    QList<PackageUpdate> updates;
+    if (!handle) {
+        return updates;
+    }
+
+    alpm_list_t* syncDbs = alpm_get_syncdbs(handle);
+    for (alpm_list_t* it = alpm_db_get_pkgcache(alpm_get_localdb(handle)); it; it = alpm_list_next(it)) {
+        auto* localPkg = static_cast<alpm_pkg_t*>(it->data);
+        alpm_pkg_t* syncPkg = alpm_sync_get_new_version(localPkg, syncDbs);
+        if (!syncPkg) {
+            continue;
+        }
+        PackageUpdate update;
+        update.name = QString::fromUtf8(alpm_pkg_get_name(localPkg));
+        update.oldVersion = QString::fromUtf8(alpm_pkg_get_version(localPkg));
+        update.newVersion = QString::fromUtf8(alpm_pkg_get_version(syncPkg));
+        update.repository = QString::fromUtf8(alpm_db_get_name(alpm_pkg_get_db(syncPkg)));
+        update.source = QStringLiteral("repo");
+        update.held = alpm_pkg_should_ignore(handle, syncPkg) != 0;
+        updates.append(update);
+    }
+    return updates;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QString>
+#include <QList>
+#include <QStringList>
+
+#include "common.h"
+
+struct _alpm_handle_t;
+
+// In-process package queries through libalpm. One handle is kept open and
+// answers every lookup from its package caches; reload() re-opens it after the
+// databases on disk have changed (pacman -Sy or a transaction).
+class AlpmBackend {
+public:
+    AlpmBackend(const QString& rootDir, const QString& dbPath, const QStringList& syncRepos,
+                const QStringList& ignorePkg, const QStringList& ignoreGroup);
+    ~AlpmBackend();
+
+    bool open();
+    bool reload();
+    void close();
+    bool isOpen() const { return handle != nullptr; }
+
+    // Same set as `pacman -Qu`, with the sync repository of each new version
+    QList<PackageUpdate> queryUpdates();
+
+private:
+    Q_DISABLE_COPY(AlpmBackend)
+
+    QString rootDir;
+    QString dbPath;
+    QStringList syncRepos;
+    QStringList ignorePkg;
+    QStringList ignoreGroup;
+    _alpm_handle_t* handle = nullptr;
+};
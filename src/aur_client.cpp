@@ -0,0 +1,133 @@
+#include "aur_client.h"
+#include "common.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QUrlQuery>
+
+namespace {
+// The AUR accepts large POST bodies; this keeps each response reasonably small
+constexpr int BATCH_SIZE = 200;
+constexpr int TRANSFER_TIMEOUT_MS = 30000;
+} // namespace
+
+AurClient::AurClient(const QUrl& endpoint, QObject* parent)
+    : QObject(parent)
+    , endpoint(endpoint)
+    , network(new QNetworkAccessManager(this))
+{
+}
+
+void AurClient::queryVersions(const QStringList& names, Callback onDone) {
+    cancel();
+    pending = names;
+    versions.clear();
+    callback = std::move(onDone);
+    if (pending.isEmpty()) {
+        finish(QString());
+        return;
+    }
+    sendBatch();
+}
+
+void AurClient::cancel() {
+    callback = nullptr;
+    if (reply) {
+        QNetworkReply* running = reply;
+        reply = nullptr;
+        running->abort();
+        running->deleteLater();
+    }
+    pending.clear();
+}
+
+void AurClient::sendBatch() {
+    // Encoded by hand: QUrlQuery leaves '+' alone, which form decoding turns
+    // into a space, and package names may contain it
+    QByteArray form;
+    const qsizetype count = qMin<qsizetype>(BATCH_SIZE, pending.size());
+    for (qsizetype i = 0; i < count; ++i) {
+        if (!form.isEmpty()) {
+            form += '&';
+        }
+        form += "arg%5B%5D=" + QUrl::toPercentEncoding(pending[i]);
+    }
+    pending.remove(0, count);
+
+    QNetworkRequest request(endpoint);
+    request.setHeader(QNetworkRequest::ContentTypeHeader, QStringLiteral("application/x-www-form-urlencoded"));
+    request.setHeader(QNetworkRequest::UserAgentHeader, QStringLiteral("update-notifier-qt/") + APP_VERSION);
+    request.setTransferTimeout(TRANSFER_TIMEOUT_MS);
+    reply = network->post(request, form);
+    connect(reply, &QNetworkReply::finished, this, &AurClient::onBatchFinished);
+}
+
+void AurClient::onBatchFinished() {
+    auto* finished = qobject_cast<QNetworkReply*>(sender());
+    if (!finished || finished != reply) {
+        return; // Abandoned by cancel()
+    }
+    reply = nullptr;
+    finished->deleteLater();
+    if (finished->error() != QNetworkReply::NoError) {
+        finish(finished->errorString());
+        return;
+    }
+
+    QJsonParseError parseError;
+    const QJsonObject response = QJsonDocument::fromJson(finished->readAll(), &parseError).object();
+    if (parseError.error != QJsonParseError::NoError) {
+        finish(QStringLiteral("Invalid AUR response: ") + parseError.errorString());
+        return;
+    }
+    if (response[QStringLiteral("type")].toString() == QStringLiteral("error")) {
+        finish(QStringLiteral("AUR error: ") + response[QStringLiteral("error")].toString());
+        return;
+    }
+    for (const QJsonValue& result : response[QStringLiteral("results")].toArray()) {
+        const QJsonObject package = result.toObject();
+        const QString name = package[QStringLiteral("Name")].toString();
+        const QString version = package[QStringLiteral("Version")].toString();
+        if (!name.isEmpty() && !version.isEmpty()) {
+            versions.insert(name, version);
+        }
+    }
+
+    if (pending.isEmpty()) {
+        finish(QString());
+    } else {
+        sendBatch();
+    }
+}
+
+void AurClient::fetchSrcInfo(const QString& packageBase, TextCallback onDone) {
+    QUrl url = endpoint.resolved(QUrl(QStringLiteral("/cgit/aur.git/plain/.SRCINFO")));
+    QUrlQuery query;
+    query.addQueryItem(QStringLiteral("h"), packageBase);
+    url.setQuery(query);
+
+    QNetworkRequest request(url);
+    request.setHeader(QNetworkRequest::UserAgentHeader, QStringLiteral("update-notifier-qt/") + APP_VERSION);
+    request.setTransferTimeout(TRANSFER_TIMEOUT_MS);
+    QNetworkReply* srcInfoReply = network->get(request);
+    connect(srcInfoReply, &QNetworkReply::finished, this, [srcInfoReply, onDone]() {
+        srcInfoReply->deleteLater();
+        if (srcInfoReply->error() != QNetworkReply::NoError) {
+            onDone(QString(), srcInfoReply->errorString());
+            return;
+        }
+        onDone(QString::fromUtf8(srcInfoReply->readAll()), QString());
+    });
+}
+
+void AurClient::finish(const QString& error) {
+    Callback onDone = std::move(callback);
+    callback = nullptr;
+    pending.clear();
+    if (onDone) {
+        onDone(versions, error);
+    }
+}
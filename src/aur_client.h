@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+#include <QUrl>
+#include <functional>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+
+const QString DEFAULT_AUR_RPC_URL = QStringLiteral("https://aur.archlinux.org/rpc/v5/info");
+
+// Client for the AUR RPC "info" endpoint. Names are sent in batches as POST
+// form data, one request after another, so they share a single keep-alive
+// connection. Only Name and Version are taken from the results.
+class AurClient : public QObject {
+    Q_OBJECT
+
+public:
+    using Callback = std::function<void(const QHash<QString, QString>& versions, const QString& error)>;
+    using TextCallback = std::function<void(const QString& text, const QString& error)>;
+
+    explicit AurClient(const QUrl& endpoint, QObject* parent = nullptr);
+
+    // Looks up names, calling onDone with name -> AUR version for those the
+    // AUR knows. A non-empty error means the lookup failed and versions is
+    // incomplete. Starting a new lookup abandons the running one.
+    void queryVersions(const QStringList& names, Callback onDone);
+    void cancel();
+    bool isActive() const { return reply != nullptr; }
+
+    // Fetches the .SRCINFO of a package base from the AUR git web interface
+    // on the endpoint's host; independent of queryVersions()
+    void fetchSrcInfo(const QString& packageBase, TextCallback onDone);
+
+private:
+    void sendBatch();
+    void onBatchFinished();
+    void finish(const QString& error);
+
+    QUrl endpoint;
+    QNetworkAccessManager* network;
+    QNetworkReply* reply = nullptr;
+    QStringList pending;
+    QHash<QString, QString> versions;
+    Callback callback;
+};
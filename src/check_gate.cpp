@@ -0,0 +1,71 @@
+#include "check_gate.h"
+#include "common.h"
+#include "system_events.h"
+#include <QFile>
+#include <QStringTokenizer>
+
+CheckGate::CheckGate(const SystemEvents* events)
+    : CheckGate(readSetting(QStringLiteral("Settings/max_cpu_pressure"), 40.0).toDouble(),
+                readSetting(QStringLiteral("Settings/max_io_pressure"), 20.0).toDouble(),
+                readSetting(QStringLiteral("Settings/max_memory_pressure"), 10.0).toDouble(),
+                readBoolSetting(QStringLiteral("Settings/defer_on_battery"), true),
+                readBoolSetting(QStringLiteral("Settings/defer_on_metered"), true), QStringLiteral("/proc/pressure"),
+                events)
+{
+}
+
+CheckGate::CheckGate(double maxCpuPressure, double maxIoPressure, double maxMemoryPressure, bool deferOnBattery,
+                     bool deferOnMetered, const QString& pressureDir, const SystemEvents* events)
+    : maxCpuPressure(maxCpuPressure)
+    , maxIoPressure(maxIoPressure)
+    , maxMemoryPressure(maxMemoryPressure)
+    , deferOnBattery(deferOnBattery)
+    , deferOnMetered(deferOnMetered)
+    , pressureDir(pressureDir)
+    , events(events)
+{
+}
+
+QString CheckGate::deferReason() const {
+    const struct {
+        const char* resource;
+        double limit;
+    } limits[] = {{"cpu", maxCpuPressure}, {"io", maxIoPressure}, {"memory", maxMemoryPressure}};
+    for (const auto& limit : limits) {
+        if (limit.limit <= 0) {
+            continue;
+        }
+        const QString resource = QString::fromLatin1(limit.resource);
+        const double value = pressure(resource);
+        if (value > limit.limit) {
+            return QStringLiteral("%1 pressure %2% above %3%").arg(resource).arg(value, 0, 'f', 1).arg(limit.limit);
+        }
+    }
+    if (deferOnBattery && events && events->onBattery()) {
+        return QStringLiteral("on battery");
+    }
+    if (deferOnMetered && events && events->isMetered()) {
+        return QStringLiteral("metered connection");
+    }
+    return QString();
+}
+
+double CheckGate::pressure(const QString& resource) const {
+    // "some avg10=0.00 avg60=0.00 avg300=0.00 total=0"
+    QFile file(pressureDir + u'/' + resource);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return 0; // Kernel without PSI
+    }
+    const QString content = QString::fromLatin1(file.readAll());
+    for (QStringView line : QStringTokenizer{content, u'\n', Qt::SkipEmptyParts}) {
+        if (!line.startsWith(u"some ")) {
+            continue;
+        }
+        for (QStringView field : QStringTokenizer{line, u' ', Qt::SkipEmptyParts}) {
+            if (field.startsWith(u"avg60=")) {
+                return field.mid(6).toDouble();
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QString>
+
+class SystemEvents;
+
+// Decides whether a scheduled check may run now. Checks are deferred while the
+// machine is under CPU, I/O or memory pressure (PSI averages over the last
+// minute), while running on battery (UPower) and while the primary connection
+// is metered (NetworkManager). Each condition is configurable in root's
+// settings; services that are not running simply do not defer anything.
+// Battery and metered state come from events, which keeps them up to date
+// from signals, so deciding never waits on the bus.
+class CheckGate {
+public:
+    explicit CheckGate(const SystemEvents* events);
+    // Explicit limits and PSI files under pressureDir instead of root's
+    // settings and /proc/pressure
+    CheckGate(double maxCpuPressure, double maxIoPressure, double maxMemoryPressure, bool deferOnBattery,
+              bool deferOnMetered, const QString& pressureDir, const SystemEvents* events);
+
+    // Empty when the check may run, otherwise a short reason for the state
+    QString deferReason() const;
+
+private:
+    double pressure(const QString& resource) const;
+
+    double maxCpuPressure;    // Percent, "some" avg60; <= 0 disables
+    double maxIoPressure;
+    double maxMemoryPressure;
+    bool deferOnBattery;
+    bool deferOnMetered;
+    QString pressureDir;
+    const SystemEvents* events; // Null: battery and metered never defer
+};
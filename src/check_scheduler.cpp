@@ -0,0 +1,101 @@
+#include "check_scheduler.h"
+#include <QCryptographicHash>
+#include <QSysInfo>
+#include <QtEndian>
+
+namespace {
+// Host offset as a fraction of the interval, and its cap when a check is overdue
+constexpr double JITTER_FRACTION = 0.1;
+constexpr int MAX_OVERDUE_DELAY = 300;
+// Retry delay for a deferred check, capped by the interval
+constexpr int DEFER_RETRY = 600;
+// QTimer intervals are int milliseconds (about 24.8 days)
+constexpr qint64 MAX_TIMER_SECONDS = 20 * 24 * 3600;
+
+double machineFraction() {
+    QByteArray id = QSysInfo::machineUniqueId();
+    if (id.isEmpty()) {
+        id = QSysInfo::machineHostName().toUtf8();
+    }
+    const QByteArray digest = QCryptographicHash::hash(id, QCryptographicHash::Sha1);
+    return qFromBigEndian<quint32>(digest.constData()) / 4294967296.0;
+}
+} // namespace
+
+CheckScheduler::CheckScheduler(int baseInterval)
+    : base(qMax(60, baseInterval))
+    , current(base)
+    , hostFraction(machineFraction())
+{
+}
+
+void CheckScheduler::restore(const QJsonObject& schedule, qint64 lastCheckedAt) {
+    const int savedInterval = schedule[QStringLiteral("interval")].toInt();
+    current = savedInterval > 0 ? qBound(minInterval(), savedInterval, maxInterval()) : base;
+    nextCheck = schedule[QStringLiteral("next_check_at")].toInteger();
+    deferredSince = schedule[QStringLiteral("deferred_since")].toInteger();
+    if (nextCheck <= 0) {
+        nextCheck = lastCheckedAt + current + jitterSeconds(current);
+    }
+}
+
+QJsonObject CheckScheduler::toJson() const {
+    QJsonObject schedule;
+    schedule[QStringLiteral("interval")] = current;
+    schedule[QStringLiteral("next_check_at")] = nextCheck;
+    schedule[QStringLiteral("deferred_since")] = deferredSince;
+    return schedule;
+}
+
+void CheckScheduler::setBaseInterval(int seconds, qint64 lastCheckedAt) {
+    const int previousBase = base;
+    base = qMax(60, seconds);
+    if (base == previousBase) {
+        return;
+    }
+    // Keep how far the interval had adapted, relative to the new base
+    current = qBound(minInterval(), static_cast<int>(qint64(current) * base / previousBase), maxInterval());
+    nextCheck = lastCheckedAt + current + jitterSeconds(current);
+}
+
+void CheckScheduler::recordCheck(qint64 checkedAt, bool changed) {
+    if (changed) {
+        current = qMax(minInterval(), current / 2);
+    } else {
+        current = qMin(maxInterval(), current + current / 4);
+    }
+    nextCheck = checkedAt + current + jitterSeconds(current);
+    deferredSince = 0;
+}
+
+void CheckScheduler::recordFailure(qint64 failedAt) {
+    nextCheck = failedAt + current + jitterSeconds(current);
+    deferredSince = 0;
+}
+
+void CheckScheduler::recordDeferral(qint64 deferredAt) {
+    if (deferredSince == 0) {
+        deferredSince = deferredAt;
+    }
+    nextCheck = deferredAt + qMin(DEFER_RETRY, current);
+}
+
+int CheckScheduler::secondsUntilDue(qint64 now) const {
+    const qint64 dueIn = nextCheck - now;
+    if (dueIn <= 0) {
+        return qMin(MAX_OVERDUE_DELAY, jitterSeconds(current));
+    }
+    return static_cast<int>(qMin(dueIn, MAX_TIMER_SECONDS));
+}
+
+int CheckScheduler::jitterSeconds(int interval) const {
+    return static_cast<int>(interval * JITTER_FRACTION * hostFraction);
+}
+
+int CheckScheduler::minInterval() const {
+    return qMax(60, base / 2);
+}
+
+int CheckScheduler::maxInterval() const {
+    return base * 4;
+}
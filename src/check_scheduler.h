@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QtGlobal>
+
+// Decides when the next update check is due. The due time is persisted in the
+// state, so a daemon restart (or an idle exit) does not push it back. Each
+// host adds a fixed, machine-id derived offset so a fleet booted together
+// spreads its syncs, and the interval adapts between half and four times the
+// configured one: checks that keep finding nothing new run less often, a
+// check that finds changes brings the interval back down.
+class CheckScheduler {
+public:
+    explicit CheckScheduler(int baseInterval);
+
+    // Restores from the "schedule" object of the state; falls back to
+    // lastCheckedAt + interval when nothing was saved
+    void restore(const QJsonObject& schedule, qint64 lastCheckedAt);
+    QJsonObject toJson() const;
+
+    void setBaseInterval(int seconds, qint64 lastCheckedAt);
+    int baseInterval() const { return base; }
+    int interval() const { return current; }
+    qint64 nextCheckAt() const { return nextCheck; }
+    bool isDue(qint64 now) const { return now >= nextCheck; }
+
+    // A check finished at checkedAt; changed says whether it found a different
+    // set of pending updates than the one before it
+    void recordCheck(qint64 checkedAt, bool changed);
+    // A check failed; retry after the current interval without adapting it
+    void recordFailure(qint64 failedAt);
+    // A due check was held back; try again after a short delay
+    void recordDeferral(qint64 deferredAt);
+    // Deferrals have held the check back for a whole base interval; it then
+    // runs regardless, so a machine that stays on battery still checks
+    bool isDeferralExhausted(qint64 now) const { return deferredSince > 0 && now - deferredSince >= base; }
+
+    // Seconds until the next check (0 when overdue, then at most the host
+    // offset so hosts starting together do not check in the same second)
+    int secondsUntilDue(qint64 now) const;
+
+private:
+    int jitterSeconds(int interval) const;
+    int minInterval() const;
+    int maxInterval() const;
+
+    int base;
+    int current;
+    qint64 nextCheck = 0;
+    qint64 deferredSince = 0; // First deferral since the last check, 0 if none
+    double hostFraction; // Stable per host, in [0, 1)
+};
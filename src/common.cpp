@@ -1,9 +1,13 @@
 #include "common.h"
 #include <QDateTime>
 #include <QDebug>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
 #include <QHash>
 #include <QJsonArray>
 #include <QProcess>
+#include <QRegularExpression>
+#include <algorithm>
 
 void ensureNotRoot() {
   if (geteuid() == 0) {
@@ -29,17 +33,270 @@ QJsonObject defaultState() {
   counts[QStringLiteral("total_upgrade")] = 0;
   counts[QStringLiteral("remove")] = 0;
   counts[QStringLiteral("held")] = 0;
+  counts[QStringLiteral("devel")] = 0;
   state[QStringLiteral("counts")] = counts;
   state[QStringLiteral("packages")] = QJsonArray();
   state[QStringLiteral("aur_packages")] = QJsonArray();
+  state[QStringLiteral("held_packages")] = QJsonArray();
+  state[QStringLiteral("remove_packages")] = QJsonArray();
+  // VCS packages whose upstream moved past the installed build
+  state[QStringLiteral("devel_packages")] = QJsonArray();
   state[QStringLiteral("errors")] = QJsonArray();
   state[QStringLiteral("status")] = QStringLiteral("idle");
+  state[QStringLiteral("partial")] = false;
+  // Fingerprint of the pacman DBs the result was computed from; cache_hit is
+  // set when a check reused the previous result because nothing changed
+  state[QStringLiteral("db_fingerprint")] = QStringLiteral("");
+  state[QStringLiteral("cache_hit")] = false;
+  // Why the last scheduled check was held back (load, battery, metered link)
+  state[QStringLiteral("deferred_reason")] = QStringLiteral("");
   // AUR settings (stored in state file so root system monitor can access them)
   state[QStringLiteral("aur_enabled")] = false;
   state[QStringLiteral("aur_helper")] = QStringLiteral("");
+  // When the AUR versions behind aur_packages were last fetched
+  state[QStringLiteral("aur_checked_at")] = 0;
   return state;
 }
 
+QJsonObject PackageUpdate::toJson() const {
+  QJsonObject record;
+  record[QStringLiteral("name")] = name;
+  record[QStringLiteral("old")] = oldVersion;
+  record[QStringLiteral("new")] = newVersion;
+  record[QStringLiteral("repo")] = repository;
+  record[QStringLiteral("source")] = source;
+  if (held) {
+    record[QStringLiteral("held")] = true;
+  }
+  if (!prefetch.isEmpty()) {
+    record[QStringLiteral("prefetch")] = prefetch;
+  }
+  return record;
+}
+
+PackageUpdate PackageUpdate::fromJson(const QJsonValue &value) {
+  if (value.isString()) {
+    return fromLine(value.toString(), QString());
+  }
+  QJsonObject record = value.toObject();
+  PackageUpdate update;
+  update.name = record[QStringLiteral("name")].toString();
+  update.oldVersion = record[QStringLiteral("old")].toString();
+  update.newVersion = record[QStringLiteral("new")].toString();
+  update.repository = record[QStringLiteral("repo")].toString();
+  update.source = record[QStringLiteral("source")].toString();
+  update.held = record[QStringLiteral("held")].toBool();
+  update.prefetch = record[QStringLiteral("prefetch")].toString();
+  return update;
+}
+
+PackageUpdate PackageUpdate::fromLine(const QString &line,
+                                      const QString &source) {
+  // "name old -> new" as printed by pacman -Qu and AUR helpers
+  static const QRegularExpression updateRe(
+      QStringLiteral(R"(^(\S+)\s+(\S+)\s+->\s+(\S+))"));
+  PackageUpdate update;
+  update.source = source;
+  if (source == QStringLiteral("aur")) {
+    update.repository = QStringLiteral("aur");
+  }
+  update.held = line.endsWith(QStringLiteral("[ignored]"));
+  QRegularExpressionMatch match = updateRe.match(line);
+  if (match.hasMatch()) {
+    update.name = match.captured(1);
+    update.oldVersion = match.captured(2);
+    update.newVersion = match.captured(3);
+  } else {
+    QStringView lineView(line);
+    qsizetype spaceIndex = lineView.indexOf(u' ');
+    update.name =
+        (spaceIndex < 0 ? lineView : lineView.left(spaceIndex)).toString();
+  }
+  return update;
+}
+
+namespace {
+// ASCII classes as in the C locale pacman compares in
+bool isVersionDigit(QChar c) { return c.unicode() >= u'0' && c.unicode() <= u'9'; }
+bool isVersionAlpha(QChar c) {
+  const char16_t u = c.unicode();
+  return (u >= u'a' && u <= u'z') || (u >= u'A' && u <= u'Z');
+}
+bool isVersionAlnum(QChar c) { return isVersionDigit(c) || isVersionAlpha(c); }
+
+// rpmvercmp() from libalpm's version.c, on views instead of NUL-terminated
+// copies
+int rpmvercmp(QStringView a, QStringView b) {
+  if (a == b) {
+    return 0;
+  }
+  const qsizetype size1 = a.size();
+  const qsizetype size2 = b.size();
+  qsizetype one = 0, two = 0;   // Start of the current segments
+  qsizetype ptr1 = 0, ptr2 = 0; // End of the previous segments
+
+  while (one < size1 && two < size2) {
+    while (one < size1 && !isVersionAlnum(a[one])) {
+      ++one;
+    }
+    while (two < size2 && !isVersionAlnum(b[two])) {
+      ++two;
+    }
+    if (one >= size1 || two >= size2) {
+      break;
+    }
+    // Different separator lengths decide
+    if (one - ptr1 != two - ptr2) {
+      return one - ptr1 < two - ptr2 ? -1 : 1;
+    }
+    ptr1 = one;
+    ptr2 = two;
+
+    // Grab a completely numeric or completely alpha segment
+    bool isNum;
+    if (isVersionDigit(a[ptr1])) {
+      while (ptr1 < size1 && isVersionDigit(a[ptr1])) {
+        ++ptr1;
+      }
+      while (ptr2 < size2 && isVersionDigit(b[ptr2])) {
+        ++ptr2;
+      }
+      isNum = true;
+    } else {
+      while (ptr1 < size1 && isVersionAlpha(a[ptr1])) {
+        ++ptr1;
+      }
+      while (ptr2 < size2 && isVersionAlpha(b[ptr2])) {
+        ++ptr2;
+      }
+      isNum = false;
+    }
+    if (one == ptr1) {
+      return -1; // Cannot happen: a has a non-empty segment here
+    }
+    // Segments of different types: numeric is newer than alpha
+    if (two == ptr2) {
+      return isNum ? 1 : -1;
+    }
+
+    QStringView segment1 = a.sliced(one, ptr1 - one);
+    QStringView segment2 = b.sliced(two, ptr2 - two);
+    if (isNum) {
+      while (!segment1.isEmpty() && segment1.front() == u'0') {
+        segment1 = segment1.sliced(1);
+      }
+      while (!segment2.isEmpty() && segment2.front() == u'0') {
+        segment2 = segment2.sliced(1);
+      }
+      // The number with more digits wins
+      if (segment1.size() != segment2.size()) {
+        return segment1.size() > segment2.size() ? 1 : -1;
+      }
+    }
+    const int rc = segment1.compare(segment2);
+    if (rc != 0) {
+      return rc < 0 ? -1 : 1;
+    }
+    one = ptr1;
+    two = ptr2;
+  }
+
+  // All segments equal, only the separators differed
+  if (one >= size1 && two >= size2) {
+    return 0;
+  }
+  // A remaining alpha part never beats an empty string: if a is empty and
+  // b is not alpha, or a is alpha, b is newer; otherwise a is newer
+  if ((one >= size1 && !isVersionAlpha(b[two])) || (one < size1 && isVersionAlpha(a[one]))) {
+    return -1;
+  }
+  return 1;
+}
+
+// parseEVR(): splits "[epoch:]version[-release]"; a missing epoch is "0"
+void parseEvr(QStringView evr, QStringView &epoch, QStringView &version, QStringView &release,
+              bool &hasRelease) {
+  qsizetype epochEnd = 0;
+  while (epochEnd < evr.size() && isVersionDigit(evr[epochEnd])) {
+    ++epochEnd;
+  }
+  const qsizetype releaseDash = evr.lastIndexOf(u'-');
+  qsizetype versionStart = 0;
+  if (epochEnd < evr.size() && evr[epochEnd] == u':') {
+    epoch = epochEnd > 0 ? evr.first(epochEnd) : QStringView(u"0");
+    versionStart = epochEnd + 1;
+  } else {
+    epoch = QStringView(u"0");
+  }
+  hasRelease = releaseDash >= versionStart;
+  if (hasRelease) {
+    version = evr.sliced(versionStart, releaseDash - versionStart);
+    release = evr.sliced(releaseDash + 1);
+  } else {
+    version = evr.sliced(versionStart);
+    release = QStringView();
+  }
+}
+} // namespace
+
+int vercmp(QStringView a, QStringView b) {
+  if (a == b) {
+    return 0;
+  }
+  QStringView epoch1, version1, release1;
+  QStringView epoch2, version2, release2;
+  bool hasRelease1 = false;
+  bool hasRelease2 = false;
+  parseEvr(a, epoch1, version1, release1, hasRelease1);
+  parseEvr(b, epoch2, version2, release2, hasRelease2);
+
+  int ret = rpmvercmp(epoch1, epoch2);
+  if (ret == 0) {
+    ret = rpmvercmp(version1, version2);
+    // The release only counts when both sides have one
+    if (ret == 0 && hasRelease1 && hasRelease2) {
+      ret = rpmvercmp(release1, release2);
+    }
+  }
+  return ret;
+}
+
+void vercmpBatch(std::span<const VersionPair> pairs, std::span<int> results) {
+  const size_t count = std::min(pairs.size(), results.size());
+  for (size_t i = 0; i < count; ++i) {
+    results[i] = vercmp(pairs[i].local, pairs[i].sync);
+  }
+}
+
+void sortVersions(std::span<QStringView> versions) {
+  std::sort(versions.begin(), versions.end(),
+            [](QStringView a, QStringView b) { return vercmp(a, b) < 0; });
+}
+
+QJsonArray packageUpdatesToJson(const QList<PackageUpdate> &updates) {
+  QJsonArray array;
+  for (const PackageUpdate &update : updates) {
+    array.append(update.toJson());
+  }
+  return array;
+}
+
+QList<PackageUpdate> packageUpdatesFromJson(const QJsonArray &array) {
+  QList<PackageUpdate> updates;
+  updates.reserve(array.size());
+  for (const QJsonValue &value : array) {
+    updates.append(PackageUpdate::fromJson(value));
+  }
+  return updates;
+}
+
+QString packageEntryName(const QJsonValue &entry) {
+  if (entry.isObject()) {
+    return entry.toObject()[QStringLiteral("name")].toString();
+  }
+  return PackageUpdate::fromLine(entry.toString(), QString()).name;
+}
+
 QString stateChecksum(const QJsonObject &state) {
   QJsonDocument doc(state);
   QByteArray payload = doc.toJson(QJsonDocument::Compact);
@@ -309,9 +566,53 @@ bool isAllowedAurHelper(const QString& helper) {
    return knownAurHelpers().contains(helper);
 }
 
+QString resolveExecutable(const QString &name) {
+  // Misses are cached too; most lookups are probes for optional tools
+  static QHash<QString, QString> resolved;
+  static QFileSystemWatcher *pathWatcher = nullptr;
+  // A PATH entry that does not exist yet (~/.local/bin before the first
+  // install) is covered by its nearest existing parent, so creating it
+  // invalidates the cache and gets it watched in turn.
+  static const auto watchPath = [] {
+    QStringList directories;
+    for (const QString &entry :
+         qEnvironmentVariable("PATH").split(QLatin1Char(':'), Qt::SkipEmptyParts)) {
+      QFileInfo directory(entry);
+      while (!directory.isDir() && !directory.isRoot()) {
+        directory = QFileInfo(directory.absolutePath()); // Parent
+      }
+      if (directory.isDir() && !directories.contains(directory.absoluteFilePath())) {
+        directories.append(directory.absoluteFilePath());
+      }
+    }
+    const QStringList watched = pathWatcher->directories();
+    directories.removeIf([&watched](const QString &directory) { return watched.contains(directory); });
+    if (!directories.isEmpty()) {
+      pathWatcher->addPaths(directories);
+    }
+  };
+  if (!pathWatcher && QCoreApplication::instance()) {
+    pathWatcher = new QFileSystemWatcher(QCoreApplication::instance());
+    watchPath();
+    QObject::connect(pathWatcher, &QFileSystemWatcher::directoryChanged, [](const QString &) {
+      resolved.clear();
+      watchPath();
+    });
+  }
+  if (!pathWatcher) {
+    return QStandardPaths::findExecutable(name); // No event loop to invalidate
+  }
+
+  auto it = resolved.constFind(name);
+  if (it == resolved.constEnd()) {
+    it = resolved.insert(name, QStandardPaths::findExecutable(name));
+  }
+  return it.value();
+}
+
 QString detectAurHelper() {
    for (const QString& helper : knownAurHelpers()) {
-       if (!QStandardPaths::findExecutable(helper).isEmpty()) {
+       if (!resolveExecutable(helper).isEmpty()) {
            return helper;
        }
    }
@@ -3,13 +3,17 @@
 #include "version.h"
 
 #include <array>
+#include <span>
 #include <QCoreApplication>
 #include <QCryptographicHash>
 #include <QDir>
 #include <QFile>
+#include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QJsonValue>
 #include <QLatin1StringView>
+#include <QList>
 #include <QSettings>
 #include <QStandardPaths>
 #include <QStringList>
@@ -23,6 +27,8 @@ const QString APP_VERSION = QStringLiteral(APP_VERSION_STR);
 const QString ENV_ROOT = QStringLiteral("UPDATE_NOTIFIER_QT_PATH");
 const QString STATE_DIR_PATH = QStringLiteral("/var/lib/update-notifier-qt");
 const QString STATE_FILE_PATH = STATE_DIR_PATH + QStringLiteral("/state.json");
+// Private pacman DBPath used by the system monitor for update checks
+const QString PRIVATE_DB_PATH = STATE_DIR_PATH + QStringLiteral("/db");
 const QString DEFAULT_DATA_ROOT_PATH =
     QStringLiteral("/usr/share/update-notifier-qt");
 
@@ -42,7 +48,42 @@ inline constexpr std::array<QLatin1StringView, 2> UPGRADE_MODES = {
     QLatin1StringView("standard"),
     QLatin1StringView("include AUR updates")};
 
+// One pending update. The monitor parses query output into these once per
+// refresh; the state file, D-Bus payloads and the view share the format.
+struct PackageUpdate {
+  QString name;
+  QString oldVersion;
+  QString newVersion;
+  QString repository; // Sync repository or "aur"; empty when unknown
+  QString source;     // "repo" or "aur"
+  bool held = false;  // Listed by IgnorePkg/IgnoreGroup ("[ignored]")
+  QString prefetch;   // Background download status; empty when not prefetched
+
+  QJsonObject toJson() const;
+  // Accepts records and legacy "name old -> new" strings
+  static PackageUpdate fromJson(const QJsonValue &value);
+  static PackageUpdate fromLine(const QString &line, const QString &source);
+};
+QJsonArray packageUpdatesToJson(const QList<PackageUpdate> &updates);
+QList<PackageUpdate> packageUpdatesFromJson(const QJsonArray &array);
+
+// pacman's version ordering (alpm_pkg_vercmp, vercmp(8)) for
+// "[epoch:]pkgver[-pkgrel]": negative, zero or positive as a is older than,
+// equal to or newer than b. Works on the views without allocating.
+int vercmp(QStringView a, QStringView b);
+struct VersionPair {
+  QStringView local;
+  QStringView sync;
+};
+// results[i] = vercmp(pairs[i].local, pairs[i].sync); results must be at
+// least as long as pairs
+void vercmpBatch(std::span<const VersionPair> pairs, std::span<int> results);
+// Sorts oldest first
+void sortVersions(std::span<QStringView> versions);
+
 QJsonObject defaultState();
+// Package name of a "packages"/"aur_packages" state entry
+QString packageEntryName(const QJsonValue &entry);
 QJsonObject readState(const QString &path = STATE_FILE_PATH,
                       bool requireChecksum = true);
 QSettings &settings();
@@ -58,6 +99,10 @@ void ensureNotRoot();
 void writeSetting(const QString &key, const QVariant &value);
 void writeState(const QJsonObject &state,
                 const QString &path = STATE_FILE_PATH);
+// QStandardPaths::findExecutable() with a per-process cache, dropped when a
+// directory on PATH changes (a package was installed or removed). Returns an
+// empty string for names not found. Main thread only.
+QString resolveExecutable(const QString &name);
 QString detectAurHelper();
 // Fixed allowlist of AUR helpers the root daemon is permitted to execute.
 QStringList knownAurHelpers();
@@ -0,0 +1,38 @@
+#include "dbus_types.h"
+#include <QDBusMetaType>
+
+QDBusArgument& operator<<(QDBusArgument& argument, const UpdateSummary& summary) {
+    argument.beginStructure();
+    argument << summary.upgrade << summary.aurUpgrade << summary.totalUpgrade << summary.remove << summary.held
+             << summary.devel << summary.checkedAt;
+    argument.endStructure();
+    return argument;
+}
+
+const QDBusArgument& operator>>(const QDBusArgument& argument, UpdateSummary& summary) {
+    argument.beginStructure();
+    argument >> summary.upgrade >> summary.aurUpgrade >> summary.totalUpgrade >> summary.remove >> summary.held >>
+        summary.devel >> summary.checkedAt;
+    argument.endStructure();
+    return argument;
+}
+
+QDBusArgument& operator<<(QDBusArgument& argument, const PackageRow& row) {
+    argument.beginStructure();
+    argument << row.name << row.oldVersion << row.newVersion << row.repository;
+    argument.endStructure();
+    return argument;
+}
+
+const QDBusArgument& operator>>(const QDBusArgument& argument, PackageRow& row) {
+    argument.beginStructure();
+    argument >> row.name >> row.oldVersion >> row.newVersion >> row.repository;
+    argument.endStructure();
+    return argument;
+}
+
+void registerDBusTypes() {
+    qDBusRegisterMetaType<UpdateSummary>();
+    qDBusRegisterMetaType<PackageRow>();
+    qDBusRegisterMetaType<QList<PackageRow>>();
+}
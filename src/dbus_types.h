@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QDBusArgument>
+#include <QList>
+#include <QMetaType>
+#include <QString>
+
+// Typed counterparts of the monitor's JSON state for D-Bus clients that only
+// need numbers or a page of rows (see dbus/org.mxlinux.UpdateNotifierSystemMonitor.xml)
+
+// D-Bus signature (iiiiiix)
+struct UpdateSummary {
+    qint32 upgrade = 0;      // Repo updates
+    qint32 aurUpgrade = 0;
+    qint32 totalUpgrade = 0; // Repo plus AUR
+    qint32 remove = 0;       // Installed packages the upgrade removes
+    qint32 held = 0;         // IgnorePkg/IgnoreGroup
+    qint32 devel = 0;        // VCS packages behind upstream
+    qint64 checkedAt = 0;
+};
+
+// One pending update, D-Bus signature (ssss): repo updates first, then AUR
+struct PackageRow {
+    QString name;
+    QString oldVersion;
+    QString newVersion;
+    QString repository; // Sync repository or "aur"
+};
+
+Q_DECLARE_METATYPE(UpdateSummary)
+Q_DECLARE_METATYPE(PackageRow)
+
+QDBusArgument& operator<<(QDBusArgument& argument, const UpdateSummary& summary);
+const QDBusArgument& operator>>(const QDBusArgument& argument, UpdateSummary& summary);
+QDBusArgument& operator<<(QDBusArgument& argument, const PackageRow& row);
+const QDBusArgument& operator>>(const QDBusArgument& argument, PackageRow& row);
+
+// Registers the types above with QtDBus; call before exporting or calling
+void registerDBusTypes();
@@ -0,0 +1,168 @@
+#include "devel_check_job.h"
+#include <QDebug>
+#include <QProcessEnvironment>
+#include <QStringTokenizer>
+#include <QUrl>
+
+namespace {
+constexpr int CHECK_TIMEOUT_MS = 30000;
+} // namespace
+
+std::optional<DevelSource> DevelSource::parse(const QString& source) {
+    QString spec = source.trimmed();
+    const qsizetype rename = spec.indexOf(QStringLiteral("::"));
+    if (rename >= 0) {
+        spec = spec.mid(rename + 2);
+    }
+
+    DevelSource result;
+    const qsizetype plus = spec.indexOf(u'+');
+    const qsizetype schemeEnd = spec.indexOf(QStringLiteral("://"));
+    if (plus > 0 && (schemeEnd < 0 || plus < schemeEnd)) {
+        result.vcs = spec.left(plus);
+        spec = spec.mid(plus + 1);
+    } else if (spec.startsWith(QStringLiteral("git://"))) {
+        result.vcs = QStringLiteral("git");
+    }
+    if (result.vcs != QStringLiteral("git") && result.vcs != QStringLiteral("hg") &&
+        result.vcs != QStringLiteral("svn")) {
+        return std::nullopt;
+    }
+
+    const qsizetype hash = spec.indexOf(u'#');
+    if (hash >= 0) {
+        const QString fragment = spec.mid(hash + 1);
+        spec.truncate(hash);
+        result.fragmentType = fragment.section(u'=', 0, 0);
+        result.fragment = fragment.section(u'=', 1);
+    }
+    // makepkg's ?signed suffix is not part of the URL
+    if (spec.endsWith(QStringLiteral("?signed"))) {
+        spec.chop(7);
+    }
+    result.url = spec;
+    return result;
+}
+
+QString DevelSource::fromSrcInfo(const QString& srcinfo) {
+    for (QStringView line : QStringTokenizer{srcinfo, u'\n', Qt::SkipEmptyParts}) {
+        line = line.trimmed();
+        const qsizetype equals = line.indexOf(u'=');
+        if (equals < 0) {
+            continue;
+        }
+        // source, source_x86_64, ...
+        const QStringView key = line.left(equals).trimmed();
+        if (key != QStringLiteral("source") && !key.startsWith(QStringLiteral("source_"))) {
+            continue;
+        }
+        const QString value = line.mid(equals + 1).trimmed().toString();
+        if (parse(value)) {
+            return value;
+        }
+    }
+    return QString();
+}
+
+bool DevelSource::isPinned() const {
+    return fragmentType == QStringLiteral("commit") || fragmentType == QStringLiteral("revision");
+}
+
+QString DevelSource::scheme() const {
+    if (!url.contains(QStringLiteral("://"))) {
+        // user@host:path
+        return url.contains(u':') ? QStringLiteral("ssh") : QString();
+    }
+    return QUrl(url).scheme();
+}
+
+DevelCheckJob::DevelCheckJob(const QHash<QString, DevelSource>& sources, int maxParallel,
+                             const QStringList& allowedSchemes, QObject* parent)
+    : ProcessRunner(parent)
+    , maxParallel(qMax(1, maxParallel))
+    , allowedSchemes(allowedSchemes)
+{
+    for (auto it = sources.cbegin(); it != sources.cend(); ++it) {
+        queue.append(qMakePair(it.key(), it.value()));
+    }
+
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    environment.insert(QStringLiteral("GIT_TERMINAL_PROMPT"), QStringLiteral("0"));
+    environment.insert(QStringLiteral("GIT_ALLOW_PROTOCOL"), allowedSchemes.join(u':'));
+    environment.insert(QStringLiteral("LC_ALL"), QStringLiteral("C"));
+    setEnvironment(environment);
+}
+
+void DevelCheckJob::start() {
+    active = true;
+    startNext();
+}
+
+void DevelCheckJob::cancel() {
+    if (!active) {
+        return;
+    }
+    active = false;
+    killProcesses();
+    emit finished();
+}
+
+void DevelCheckJob::startNext() {
+    while (active && running < maxParallel && !queue.isEmpty()) {
+        const QPair<QString, DevelSource> next = queue.takeFirst();
+        const QString package = next.first;
+        const DevelSource source = next.second;
+        if (source.isPinned()) {
+            continue;
+        }
+        // Also keeps URLs from being taken for command line options
+        if (!allowedSchemes.contains(source.scheme())) {
+            qWarning() << "Skipping devel check of" << package << ": URL scheme not allowed:" << source.url;
+            continue;
+        }
+
+        QString program;
+        QStringList args;
+        if (source.vcs == QStringLiteral("git")) {
+            program = QStringLiteral("git");
+            QString ref = QStringLiteral("HEAD");
+            if (source.fragmentType == QStringLiteral("branch")) {
+                ref = QStringLiteral("refs/heads/") + source.fragment;
+            } else if (source.fragmentType == QStringLiteral("tag")) {
+                ref = QStringLiteral("refs/tags/") + source.fragment;
+            }
+            args << QStringLiteral("ls-remote") << source.url << ref;
+        } else if (source.vcs == QStringLiteral("hg")) {
+            program = QStringLiteral("hg");
+            const QString revision = source.fragment.isEmpty() ? QStringLiteral("default") : source.fragment;
+            args << QStringLiteral("identify") << QStringLiteral("--noninteractive") << QStringLiteral("--id")
+                 << QStringLiteral("-r") << revision << source.url;
+        } else {
+            program = QStringLiteral("svn");
+            args << QStringLiteral("info") << QStringLiteral("--non-interactive") << QStringLiteral("--show-item")
+                 << QStringLiteral("last-changed-revision") << source.url;
+        }
+
+        ++running;
+        run(program, args, CHECK_TIMEOUT_MS, [this, package, source](const ProcessResult& result) {
+            onChecked(package, source, result);
+        });
+    }
+    if (active && running == 0 && queue.isEmpty()) {
+        active = false;
+        emit finished();
+    }
+}
+
+void DevelCheckJob::onChecked(const QString& package, const DevelSource& source, const ProcessResult& result) {
+    --running;
+    // First word of the output: the hash for ls-remote, the id or revision otherwise
+    const QString revision = result.output.section(u'\n', 0, 0).section(u'\t', 0, 0).trimmed();
+    if (!result.ok || result.exitCode != 0 || revision.isEmpty()) {
+        qWarning() << "Devel check of" << package << "failed:" << source.url
+                   << (result.timedOut ? QStringLiteral("timed out") : result.errorOutput.trimmed());
+    } else {
+        emit revisionFound(package, revision);
+    }
+    startNext();
+}
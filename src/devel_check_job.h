@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QStringList>
+#include <optional>
+
+#include "process_runner.h"
+
+// Upstream repository of a VCS ("-git", "-hg", "-svn") package, from the
+// first VCS entry of source= in its .SRCINFO
+struct DevelSource {
+    QString vcs;          // "git", "hg" or "svn"
+    QString url;          // Without the "vcs+" prefix and the fragment
+    QString fragmentType; // "branch", "tag", "commit", "revision", ... or empty
+    QString fragment;
+
+    // Parses "[name::]vcs+url[#type=value]" (and bare git:// URLs)
+    static std::optional<DevelSource> parse(const QString& source);
+    // First VCS source of a .SRCINFO, empty if there is none
+    static QString fromSrcInfo(const QString& srcinfo);
+    // A fixed commit or revision never changes upstream
+    bool isPinned() const;
+    QString scheme() const; // URL scheme, "ssh" for scp-like git URLs
+};
+
+// Looks up the current upstream revision of VCS packages: `git ls-remote`,
+// `hg identify` or `svn info` per package, several at a time. Prompts are
+// disabled and only URLs with an allowed scheme are contacted, since the
+// monitor runs as root. Each revision is reported as soon as it is known.
+class DevelCheckJob : public ProcessRunner {
+    Q_OBJECT
+
+public:
+    DevelCheckJob(const QHash<QString, DevelSource>& sources, int maxParallel, const QStringList& allowedSchemes,
+                  QObject* parent = nullptr);
+
+    bool isActive() const override { return active; }
+    void start();
+    void cancel();
+
+Q_SIGNALS:
+    void revisionFound(const QString& package, const QString& revision);
+    void finished();
+
+private:
+    void startNext();
+    void onChecked(const QString& package, const DevelSource& source, const ProcessResult& result);
+
+    QList<QPair<QString, DevelSource>> queue;
+    int maxParallel;
+    QStringList allowedSchemes;
+    int running = 0;
+    bool active = false;
+};
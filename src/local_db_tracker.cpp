@@ -0,0 +1,112 @@
+#include "local_db_tracker.h"
+#include "sync_db.h"
+#include <QDebug>
+#include <QFile>
+#include <QSocketNotifier>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace {
+constexpr uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+} // namespace
+
+LocalDbTracker::LocalDbTracker(const QString& localDbDir, QObject* parent)
+    : QObject(parent)
+    , localDir(localDbDir)
+{
+    inotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        qWarning() << "Cannot create inotify instance, local DB changes are rescanned";
+    } else {
+        notifier = new QSocketNotifier(inotifyFd, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, &LocalDbTracker::onEvents);
+        watch();
+    }
+    rescan();
+}
+
+LocalDbTracker::~LocalDbTracker() {
+    if (inotifyFd >= 0) {
+        ::close(inotifyFd);
+    }
+}
+
+void LocalDbTracker::watch() {
+    watchDescriptor = ::inotify_add_watch(inotifyFd, QFile::encodeName(localDir).constData(), WATCH_MASK);
+    if (watchDescriptor < 0) {
+        qWarning() << "Cannot watch local package database" << localDir;
+    }
+}
+
+void LocalDbTracker::rescan() {
+    installed = readLocalPackages(localDir);
+    changedNames.clear();
+    changesComplete = false;
+}
+
+bool LocalDbTracker::takeChanges(QSet<QString>& names) {
+    if (!isWatching()) {
+        // Without events the table is only as fresh as the last listing
+        rescan();
+    }
+    const bool complete = changesComplete;
+    names = std::move(changedNames);
+    changedNames.clear();
+    changesComplete = isWatching();
+    return complete;
+}
+
+void LocalDbTracker::entryAdded(const QString& entry) {
+    QString name;
+    QString version;
+    if (splitLocalEntry(entry, name, version)) {
+        installed.insert(name, version);
+        changedNames.insert(name);
+    }
+}
+
+void LocalDbTracker::entryRemoved(const QString& entry) {
+    QString name;
+    QString version;
+    if (!splitLocalEntry(entry, name, version)) {
+        return;
+    }
+    // An upgrade may create the new entry before the old one is deleted
+    if (installed.value(name) == version) {
+        installed.remove(name);
+    }
+    changedNames.insert(name);
+}
+
+void LocalDbTracker::onEvents() {
+    alignas(inotify_event) char buffer[16384];
+    bool lost = false;
+    ssize_t length;
+    while ((length = ::read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+        for (char* next = buffer; next < buffer + length;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(next);
+            next += sizeof(inotify_event) + event->len;
+            if (event->mask & IN_Q_OVERFLOW) {
+                lost = true;
+            } else if (event->mask & IN_IGNORED) {
+                // local/ was removed or replaced; watch whatever is there now
+                watchDescriptor = -1;
+                lost = true;
+            } else if (event->len > 0 && (event->mask & IN_ISDIR)) {
+                const QString entry = QFile::decodeName(event->name);
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    entryAdded(entry);
+                } else {
+                    entryRemoved(entry);
+                }
+            }
+        }
+    }
+    if (lost) {
+        qWarning() << "Local package database events lost, rescanning" << localDir;
+        if (!isWatching()) {
+            watch();
+        }
+        rescan();
+    }
+}
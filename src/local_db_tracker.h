@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+
+class QSocketNotifier;
+
+// Installed packages (name -> version) of the local pacman DB, kept current
+// through inotify on the local/ directory: a transaction adds and removes one
+// "<name>-<version>" entry per package, so only those names are updated. The
+// table is rebuilt from a full directory listing at start, when the event
+// queue overflows and when the directory itself is replaced.
+class LocalDbTracker : public QObject {
+    Q_OBJECT
+
+public:
+    explicit LocalDbTracker(const QString& localDbDir, QObject* parent = nullptr);
+    ~LocalDbTracker() override;
+
+    bool isWatching() const { return watchDescriptor >= 0; }
+    const QHash<QString, QString>& packages() const { return installed; }
+    QString version(const QString& name) const { return installed.value(name); }
+
+    // Moves the names installed, removed or upgraded since the previous call
+    // into names. Returns false when changes went unrecorded (not watching,
+    // overflow, first call); the caller then has to look at every package.
+    bool takeChanges(QSet<QString>& names);
+
+private Q_SLOTS:
+    void onEvents();
+
+private:
+    void watch();
+    void rescan();
+    void entryAdded(const QString& entry);
+    void entryRemoved(const QString& entry);
+
+    QString localDir;
+    int inotifyFd = -1;
+    int watchDescriptor = -1;
+    QSocketNotifier* notifier = nullptr;
+    QHash<QString, QString> installed;
+    QSet<QString> changedNames;
+    bool changesComplete = false;
+};
@@ -5,6 +5,7 @@
 #include <unistd.h>
 
 #include "common.h"
+#include "dbus_types.h"
 #include "system_monitor.h"
 
 int main(int argc, char *argv[]) {
@@ -15,6 +16,16 @@ int main(int argc, char *argv[]) {
     parser.addHelpOption();
     parser.addOption({QStringLiteral("debug"), QStringLiteral("Enable debug output")});
     parser.addOption({QStringLiteral("no-checksum"), QStringLiteral("Disable checksum verification for state file")});
+#ifdef HAVE_LIBALPM
+    parser.addOption({QStringLiteral("no-alpm"), QStringLiteral("Query packages with pacman processes instead of libalpm")});
+#endif
+    QCommandLineOption idleTimeoutOption(
+        QStringLiteral("idle-timeout"),
+        QStringLiteral("Exit after <seconds> without requests or running checks (0 = never); "
+                       "Settings/idle_timeout takes precedence when set"),
+        QStringLiteral("seconds"),
+        QStringLiteral("0"));
+    parser.addOption(idleTimeoutOption);
     parser.process(app);
 
     if (geteuid() != 0) {
@@ -33,7 +44,16 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    SystemMonitor monitor(!parser.isSet(QStringLiteral("no-checksum")));
+    bool useAlpm = true;
+#ifdef HAVE_LIBALPM
+    useAlpm = !parser.isSet(QStringLiteral("no-alpm"));
+#endif
+    // The unit passes a packaging default; an administrator's setting wins
+    const QString idleTimeoutKey = QStringLiteral("Settings/idle_timeout");
+    const int idleTimeout = settings().contains(idleTimeoutKey) ? readSetting(idleTimeoutKey, 0).toInt()
+                                                                : parser.value(idleTimeoutOption).toInt();
+    SystemMonitor monitor(!parser.isSet(QStringLiteral("no-checksum")), useAlpm, qMax(0, idleTimeout));
+    registerDBusTypes();
     bus.registerObject(
         SYSTEM_DBUS_PATH,
         SYSTEM_DBUS_INTERFACE,
@@ -0,0 +1,44 @@
+#include "pacman_db.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <sys/stat.h>
+
+namespace {
+void addStat(QCryptographicHash& hash, const QString& path) {
+    struct stat st;
+    hash.addData(path.toUtf8());
+    if (::stat(QFile::encodeName(path).constData(), &st) != 0) {
+        hash.addData(QByteArrayView("missing"));
+        return;
+    }
+    const qint64 fields[] = {static_cast<qint64>(st.st_dev), static_cast<qint64>(st.st_ino),
+                             static_cast<qint64>(st.st_size), static_cast<qint64>(st.st_mtim.tv_sec),
+                             static_cast<qint64>(st.st_mtim.tv_nsec)};
+    hash.addData(QByteArrayView(reinterpret_cast<const char*>(fields), sizeof(fields)));
+}
+} // namespace
+
+QString pacmanDbFingerprint(const QString& dbPath, const QStringList& extraFiles) {
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    QDir dbDir(dbPath);
+    addStat(hash, dbDir.filePath(QStringLiteral("local")));
+
+    QDir syncDir(dbDir.filePath(QStringLiteral("sync")));
+    const QStringList syncDbs = syncDir.entryList(QStringList() << QStringLiteral("*.db"), QDir::Files, QDir::Name);
+    for (const QString& syncDb : syncDbs) {
+        addStat(hash, syncDir.filePath(syncDb));
+    }
+    for (const QString& file : extraFiles) {
+        addStat(hash, file);
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+QString syncDbFingerprint(const QString& dbPath, const QStringList& repos) {
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    QDir syncDir(QDir(dbPath).filePath(QStringLiteral("sync")));
+    for (const QString& repo : repos) {
+        addStat(hash, syncDir.filePath(repo + QStringLiteral(".db")));
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
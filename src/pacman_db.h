@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+// Cheap change detection for the pacman databases: stat() data (inode, size,
+// mtime) of the local DB directory, every sync *.db file and any extra files,
+// hashed into one string. Adding or removing a package rewrites an entry in
+// local/, which bumps the directory mtime; a sync that downloads a database
+// replaces the file. Equal fingerprints mean a query would give the same answer.
+QString pacmanDbFingerprint(const QString& dbPath, const QStringList& extraFiles = QStringList());
+
+// Same as above for the sync databases of the given repos alone (in order),
+// for data derived only from them
+QString syncDbFingerprint(const QString& dbPath, const QStringList& repos);
@@ -0,0 +1,222 @@
+#include "prefetch_job.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QStringTokenizer>
+#include <QThread>
+
+const QString PrefetchJob::Pending = QStringLiteral("pending");
+const QString PrefetchJob::Downloading = QStringLiteral("downloading");
+const QString PrefetchJob::Verifying = QStringLiteral("verifying");
+const QString PrefetchJob::Ready = QStringLiteral("ready");
+const QString PrefetchJob::Failed = QStringLiteral("failed");
+
+namespace {
+// Idle CPU and I/O priority for everything the prefetch runs
+QStringList lowPriority(const QString& program) {
+    return QStringList() << QStringLiteral("-n") << QStringLiteral("19") << QStringLiteral("ionice")
+                         << QStringLiteral("-c") << QStringLiteral("3") << program;
+}
+} // namespace
+
+PrefetchJob::PrefetchJob(const QString& cacheDir, int rateLimitKiB, const QStringList& dbArgs,
+                         const QString& lockFile, QObject* parent)
+    : ProcessRunner(parent)
+    , cacheDir(cacheDir)
+    , rateLimitKiB(rateLimitKiB)
+    , dbArgs(dbArgs)
+    , lockFile(lockFile)
+{
+}
+
+void PrefetchJob::start() {
+    if (active) {
+        return;
+    }
+    active = true;
+    // -p resolves the targets without locking or downloading anything
+    const QStringList args = QStringList() << QStringLiteral("-Sup") << QStringLiteral("--print-format")
+                                           << QStringLiteral("%n %s %l") << dbArgs;
+    run(QStringLiteral("pacman"), args, 30000, [this](const ProcessResult& result) { onListed(result); });
+}
+
+void PrefetchJob::cancel() {
+    if (!active) {
+        return;
+    }
+    killProcesses();
+    for (const Item& item : std::as_const(items)) {
+        QFile::remove(stagingPath(item));
+        QFile::remove(stagingPath(item) + QStringLiteral(".sig"));
+    }
+    active = false;
+    qWarning() << "Package prefetch cancelled";
+    emit finished();
+}
+
+QHash<QString, QString> PrefetchJob::statuses() const {
+    QHash<QString, QString> result;
+    for (const Item& item : items) {
+        result.insert(item.name, item.status);
+    }
+    return result;
+}
+
+void PrefetchJob::onListed(const ProcessResult& result) {
+    if (!result.ok || result.exitCode != 0) {
+        qWarning() << "pacman -Sup failed, skipping prefetch:" << result.errorString << result.errorOutput.trimmed();
+        active = false;
+        emit finished();
+        return;
+    }
+
+    for (QStringView lineView : QStringTokenizer{result.output, u'\n', Qt::SkipEmptyParts}) {
+        const QList<QStringView> fields = lineView.trimmed().split(u' ', Qt::SkipEmptyParts);
+        if (fields.size() != 3) {
+            continue;
+        }
+        Item item;
+        item.name = fields[0].toString();
+        item.size = fields[1].toLongLong();
+        item.url = fields[2].toString();
+        item.fileName = item.url.section(u'/', -1);
+        if (item.fileName.isEmpty()) {
+            continue;
+        }
+        // Local repositories (file://) and packages already in the cache need no download
+        const bool local = item.url.startsWith(QStringLiteral("file://"));
+        item.status = local || QFile::exists(cachePath(item)) ? Ready : Pending;
+        items.append(item);
+    }
+    qWarning() << "Prefetching" << items.size() << "packages into" << cacheDir;
+    emit progress();
+    downloadNext();
+}
+
+void PrefetchJob::downloadNext() {
+    while (nextDownload < items.size() && items[nextDownload].status != Pending) {
+        ++nextDownload;
+    }
+    if (nextDownload >= items.size()) {
+        finishIfDone();
+        return;
+    }
+    if (QFile::exists(lockFile)) {
+        // A pacman transaction is running; leave the cache alone until the next check
+        qWarning() << "pacman database locked, stopping prefetch";
+        cancel();
+        return;
+    }
+
+    const int index = nextDownload++;
+    const Item& item = items[index];
+    QStringList args = lowPriority(QStringLiteral("curl"))
+        << QStringLiteral("--fail") << QStringLiteral("--silent") << QStringLiteral("--location")
+        << QStringLiteral("--retry") << QStringLiteral("2")
+        << QStringLiteral("--connect-timeout") << QStringLiteral("30");
+    if (rateLimitKiB > 0) {
+        args << QStringLiteral("--limit-rate") << QStringLiteral("%1k").arg(rateLimitKiB);
+    }
+    args << QStringLiteral("--output") << stagingPath(item) << item.url;
+
+    downloading = true;
+    setItemStatus(index, Downloading);
+    run(QStringLiteral("nice"), args, downloadTimeoutMs(item), [this, index](const ProcessResult& result) {
+        if (!result.ok || result.exitCode != 0) {
+            qWarning() << "Prefetch download failed for" << items[index].url << "exit code:" << result.exitCode;
+            QFile::remove(stagingPath(items[index]));
+            setItemStatus(index, Failed);
+            downloading = false;
+            downloadNext();
+            return;
+        }
+        downloadSignature(index);
+    });
+}
+
+void PrefetchJob::downloadSignature(int index) {
+    const Item& item = items[index];
+    const QStringList args = lowPriority(QStringLiteral("curl"))
+        << QStringLiteral("--fail") << QStringLiteral("--silent") << QStringLiteral("--location")
+        << QStringLiteral("--connect-timeout") << QStringLiteral("30")
+        << QStringLiteral("--output") << stagingPath(item) + QStringLiteral(".sig")
+        << item.url + QStringLiteral(".sig");
+    run(QStringLiteral("nice"), args, 60000, [this, index](const ProcessResult& result) {
+        downloading = false;
+        if (!result.ok || result.exitCode != 0) {
+            // Never move an unverified file into the cache
+            qWarning() << "No signature for" << items[index].fileName << "- discarding prefetched file";
+            QFile::remove(stagingPath(items[index]));
+            QFile::remove(stagingPath(items[index]) + QStringLiteral(".sig"));
+            setItemStatus(index, Failed);
+        } else {
+            setItemStatus(index, Verifying);
+            verifyQueue.append(index);
+            verifyNext();
+        }
+        downloadNext();
+    });
+}
+
+void PrefetchJob::verifyNext() {
+    // Signature checks are CPU bound and independent, so several run at once
+    // while the (bandwidth bound) downloads continue
+    const int maxVerifying = qMax(1, QThread::idealThreadCount() / 2);
+    while (!verifyQueue.isEmpty() && verifying < maxVerifying) {
+        const int index = verifyQueue.takeFirst();
+        const QString staging = stagingPath(items[index]);
+        ++verifying;
+        run(QStringLiteral("nice"),
+            lowPriority(QStringLiteral("pacman-key")) << QStringLiteral("--verify")
+                                                      << staging + QStringLiteral(".sig") << staging,
+            60000, [this, index, staging](const ProcessResult& result) {
+            --verifying;
+            const QString target = cachePath(items[index]);
+            if (result.ok && result.exitCode == 0 && QFile::rename(staging, target)) {
+                QFile::remove(target + QStringLiteral(".sig"));
+                QFile::rename(staging + QStringLiteral(".sig"), target + QStringLiteral(".sig"));
+                setItemStatus(index, Ready);
+            } else {
+                qWarning() << "Signature verification failed for" << items[index].fileName;
+                QFile::remove(staging);
+                QFile::remove(staging + QStringLiteral(".sig"));
+                setItemStatus(index, Failed);
+            }
+            verifyNext();
+            finishIfDone();
+        });
+    }
+}
+
+void PrefetchJob::setItemStatus(int index, const QString& status) {
+    items[index].status = status;
+    emit progress();
+}
+
+void PrefetchJob::finishIfDone() {
+    if (!active || downloading || verifying > 0 || !verifyQueue.isEmpty() || nextDownload < items.size()) {
+        return;
+    }
+    active = false;
+    qWarning() << "Package prefetch finished";
+    emit finished();
+}
+
+QString PrefetchJob::cachePath(const Item& item) const {
+    return QDir(cacheDir).filePath(item.fileName);
+}
+
+QString PrefetchJob::stagingPath(const Item& item) const {
+    // Not ".part": pacman would try to resume that name itself
+    return cachePath(item) + QStringLiteral(".prefetch");
+}
+
+int PrefetchJob::downloadTimeoutMs(const Item& item) const {
+    // Twice the time the transfer needs at the configured cap, and never less
+    // than ten minutes; uncapped downloads get a flat 30 minutes
+    if (rateLimitKiB <= 0) {
+        return 30 * 60 * 1000;
+    }
+    const qint64 seconds = 2 * item.size / (qint64(rateLimitKiB) * 1024);
+    return static_cast<int>(qBound<qint64>(600, seconds, 24 * 3600) * 1000);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QStringList>
+
+#include "process_runner.h"
+
+// Background download of pending repo packages into the pacman cache, the
+// equivalent of `pacman -Swu` at idle priority. Packages are downloaded one
+// at a time (optionally rate limited) into a staging name; each finished file
+// has its detached signature checked while the next one downloads, and only
+// verified files are moved to their final cache name.
+class PrefetchJob : public ProcessRunner {
+    Q_OBJECT
+
+public:
+    // Per-package values reported by statuses()
+    static const QString Pending;
+    static const QString Downloading;
+    static const QString Verifying;
+    static const QString Ready;
+    static const QString Failed;
+
+    PrefetchJob(const QString& cacheDir, int rateLimitKiB, const QStringList& dbArgs,
+                const QString& lockFile, QObject* parent = nullptr);
+
+    bool isActive() const override { return active; }
+    void start();
+    void cancel();
+    QHash<QString, QString> statuses() const; // package name -> status
+
+Q_SIGNALS:
+    void progress();
+    void finished();
+
+private:
+    struct Item {
+        QString name;
+        QString fileName;
+        QString url;
+        qint64 size = 0;
+        QString status;
+    };
+
+    void onListed(const ProcessResult& result);
+    void downloadNext();
+    void downloadSignature(int index);
+    void verifyNext();
+    void setItemStatus(int index, const QString& status);
+    void finishIfDone();
+    QString cachePath(const Item& item) const;
+    QString stagingPath(const Item& item) const;
+    int downloadTimeoutMs(const Item& item) const;
+
+    QString cacheDir;
+    int rateLimitKiB;
+    QStringList dbArgs;
+    QString lockFile;
+    QList<Item> items;
+    QList<int> verifyQueue;
+    int nextDownload = 0;
+    bool downloading = false;
+    int verifying = 0;
+    bool active = false;
+};
@@ -0,0 +1,66 @@
+#include "process_runner.h"
+#include <QTimer>
+
+ProcessRunner::ProcessRunner(QObject* parent)
+    : QObject(parent)
+{
+}
+
+void ProcessRunner::run(const QString& program, const QStringList& args, int timeoutMs,
+                        std::function<void(const ProcessResult&)> onDone) {
+    auto* process = new QProcess(this);
+    auto* timer = new QTimer(process);
+    timer->setSingleShot(true);
+    processes.append(process);
+
+    connect(timer, &QTimer::timeout, process, [process]() {
+        process->setProperty("timedOut", true);
+        process->kill();
+    });
+    connect(process, &QProcess::errorOccurred, this, [this, process, onDone](QProcess::ProcessError error) {
+        if (error != QProcess::FailedToStart) {
+            return; // Crashes and kills are reported through finished()
+        }
+        ProcessResult result;
+        result.errorString = process->errorString();
+        complete(process, result, onDone);
+    });
+    connect(process, qOverload<int, QProcess::ExitStatus>(&QProcess::finished), this,
+            [this, process, onDone](int exitCode, QProcess::ExitStatus exitStatus) {
+                ProcessResult result;
+                result.timedOut = process->property("timedOut").toBool();
+                result.ok = exitStatus == QProcess::NormalExit && !result.timedOut;
+                result.exitCode = exitCode;
+                result.output = QString::fromUtf8(process->readAllStandardOutput());
+                result.errorOutput = QString::fromUtf8(process->readAllStandardError());
+                result.errorString = process->errorString();
+                complete(process, result, onDone);
+            });
+
+    if (!processEnvironment.isEmpty()) {
+        process->setProcessEnvironment(processEnvironment);
+    }
+    process->start(program, args);
+    timer->start(timeoutMs);
+}
+
+void ProcessRunner::complete(QProcess* process, const ProcessResult& result,
+                             const std::function<void(const ProcessResult&)>& onDone) {
+    if (!processes.removeOne(process)) {
+        return;
+    }
+    process->deleteLater();
+    if (isActive()) {
+        onDone(result);
+    }
+}
+
+void ProcessRunner::killProcesses() {
+    const QList<QProcess*> running = processes;
+    processes.clear();
+    for (QProcess* process : running) {
+        disconnect(process, nullptr, this, nullptr);
+        process->kill();
+        process->deleteLater();
+    }
+}
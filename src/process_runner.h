@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QList>
+#include <QObject>
+#include <QProcess>
+#include <QStringList>
+#include <functional>
+
+struct ProcessResult {
+    bool ok = false;        // Started and exited normally before the timeout
+    bool timedOut = false;
+    int exitCode = -1;
+    QString output;
+    QString errorOutput;
+    QString errorString;
+};
+
+// Base for the monitor's background jobs. Every child process is started
+// through run() and reports back on the event loop; results that arrive after
+// the job stopped being active are dropped.
+class ProcessRunner : public QObject {
+    Q_OBJECT
+
+public:
+    explicit ProcessRunner(QObject* parent = nullptr);
+
+    virtual bool isActive() const = 0;
+    void run(const QString& program, const QStringList& args, int timeoutMs,
+             std::function<void(const ProcessResult&)> onDone);
+
+protected:
+    void killProcesses();
+    // Environment for processes started afterwards; the daemon's by default
+    void setEnvironment(const QProcessEnvironment& environment) { processEnvironment = environment; }
+
+private:
+    void complete(QProcess* process, const ProcessResult& result,
+                  const std::function<void(const ProcessResult&)>& onDone);
+
+    QList<QProcess*> processes;
+    QProcessEnvironment processEnvironment;
+};
@@ -0,0 +1,71 @@
+#include "refresh_job.h"
+#include <QDateTime>
+#include <QDebug>
+
+RefreshJob::RefreshJob(quint64 id, bool syncDb, QObject* parent)
+    : ProcessRunner(parent)
+    , jobId(id)
+    , sync(syncDb)
+    , startedAt(QDateTime::currentSecsSinceEpoch())
+{
+}
+
+bool RefreshJob::isActive() const {
+    return currentStatus != Status::Finished && currentStatus != Status::Cancelled
+        && currentStatus != Status::Failed;
+}
+
+QString RefreshJob::statusName(Status status) {
+    switch (status) {
+    case Status::WaitingForLock:
+        return QStringLiteral("waiting_for_lock");
+    case Status::Syncing:
+        return QStringLiteral("syncing");
+    case Status::Querying:
+        return QStringLiteral("querying");
+    case Status::Finished:
+        return QStringLiteral("finished");
+    case Status::Cancelled:
+        return QStringLiteral("cancelled");
+    case Status::Failed:
+        return QStringLiteral("failed");
+    }
+    return QString();
+}
+
+QJsonObject RefreshJob::toJson() const {
+    QJsonObject json;
+    json[QStringLiteral("job_id")] = static_cast<qint64>(jobId);
+    json[QStringLiteral("status")] = statusName(currentStatus);
+    json[QStringLiteral("started_at")] = startedAt;
+    json[QStringLiteral("finished_at")] = finishedAt;
+    return json;
+}
+
+void RefreshJob::setStatus(Status status) {
+    if (!isActive() || status == currentStatus) {
+        return;
+    }
+    currentStatus = status;
+    if (!isActive()) {
+        finishedAt = QDateTime::currentSecsSinceEpoch();
+    }
+    emit statusChanged();
+}
+
+void RefreshJob::cancel() {
+    if (!isActive()) {
+        return;
+    }
+    killProcesses();
+    qWarning() << "Refresh job" << jobId << "cancelled";
+    setStatus(Status::Cancelled);
+}
+
+void RefreshJob::fail() {
+    if (!isActive()) {
+        return;
+    }
+    killProcesses();
+    setStatus(Status::Failed);
+}
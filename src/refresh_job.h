@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QStringList>
+
+#include "common.h"
+#include "process_runner.h"
+
+// One asynchronous update check. SystemMonitor drives the steps; every child
+// process is started through run() and reports back on the event loop, so the
+// daemon keeps answering D-Bus calls while pacman or the AUR is busy.
+class RefreshJob : public ProcessRunner {
+    Q_OBJECT
+
+public:
+    enum class Status { WaitingForLock, Syncing, Querying, Finished, Cancelled, Failed };
+
+    RefreshJob(quint64 id, bool syncDb, QObject* parent = nullptr);
+
+    quint64 id() const { return jobId; }
+    bool syncDb() const { return sync; }
+    Status status() const { return currentStatus; }
+    bool isActive() const override;
+    QJsonObject toJson() const;
+    static QString statusName(Status status);
+
+    void setStatus(Status status);
+    void cancel();
+    void fail();
+
+    // Query results, filled in by SystemMonitor as each step completes. The
+    // repo and AUR queries run concurrently and each marks itself done.
+    QList<PackageUpdate> repoUpdates;
+    QList<PackageUpdate> aurUpdates;
+    QJsonArray removals; // Installed packages the upgrade would replace or remove
+    bool aurEnabled = false; // Whether this run queries the AUR; not written back into the state
+    bool aurStarted = false;
+    bool aurWaitsForIndex = false; // Full AUR query held until the repo query has built the sync index
+    QString aurError; // Failed AUR query; the cached AUR result is published with it
+    bool repoDone = false;
+    bool cacheHit = false; // Repo result reused because no database changed
+    QString dbFingerprint;
+    QString syncFingerprint; // Sync DBs the repo result is computed against; cleared if the query failed
+    bool offline = false; // No network when the job started: no sync, AUR result kept
+    QString baseUpdatesKey; // Pending set when the job started, to tell if it changed
+    qint64 lockDeadline = 0; // msecs since epoch; set when first blocked on db.lck
+    QJsonObject stateBeforePartial; // Published state the first-phase result replaced, for its AUR part
+    bool aurDone = false;
+
+Q_SIGNALS:
+    void statusChanged();
+
+private:
+    quint64 jobId;
+    bool sync;
+    Status currentStatus = Status::Querying;
+    qint64 startedAt;
+    qint64 finishedAt = 0;
+};
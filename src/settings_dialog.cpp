@@ -324,7 +324,7 @@ void SettingsDialog::updateAurHelperOptions() {
    const QStringList helpersToCheck = {QStringLiteral("paru"), QStringLiteral("yay"), QStringLiteral("pikaur"), QStringLiteral("aura")};
 
    for (const QString& helper : helpersToCheck) {
-       if (!QStandardPaths::findExecutable(helper).isEmpty()) {
+       if (!resolveExecutable(helper).isEmpty()) {
            availableHelpers.append(helper);
            aurHelper->addItem(helper, helper);
        }
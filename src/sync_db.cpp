@@ -0,0 +1,294 @@
+#include "sync_db.h"
+#include "common.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QThread>
+#include <archive.h>
+#include <archive_entry.h>
+
+namespace {
+QString archiveError(archive* reader) {
+    const char* message = archive_error_string(reader);
+    return message ? QString::fromUtf8(message) : QStringLiteral("unknown libarchive error");
+}
+
+// Parses a desc (or old-style depends) file: "%FIELD%" lines followed by one
+// value per line, sections separated by blank lines
+void parseDescFile(const QByteArray& data, SyncPackage& package) {
+    QStringList* list = nullptr;
+    QString* scalar = nullptr;
+    qint64* number = nullptr;
+    for (QByteArray line : data.split('\n')) {
+        line = line.trimmed();
+        if (line.isEmpty()) {
+            list = nullptr;
+            scalar = nullptr;
+            number = nullptr;
+            continue;
+        }
+        if (line.startsWith('%') && line.endsWith('%')) {
+            list = nullptr;
+            scalar = nullptr;
+            number = nullptr;
+            if (line == "%NAME%") {
+                scalar = &package.name;
+            } else if (line == "%VERSION%") {
+                scalar = &package.version;
+            } else if (line == "%DESC%") {
+                scalar = &package.description;
+            } else if (line == "%FILENAME%") {
+                scalar = &package.fileName;
+            } else if (line == "%CSIZE%") {
+                number = &package.downloadSize;
+            } else if (line == "%ISIZE%") {
+                number = &package.installedSize;
+            } else if (line == "%GROUPS%") {
+                list = &package.groups;
+            } else if (line == "%DEPENDS%") {
+                list = &package.depends;
+            } else if (line == "%REPLACES%") {
+                list = &package.replaces;
+            } else if (line == "%CONFLICTS%") {
+                list = &package.conflicts;
+            } else if (line == "%PROVIDES%") {
+                list = &package.provides;
+            }
+            continue;
+        }
+        if (scalar) {
+            *scalar = QString::fromUtf8(line);
+            scalar = nullptr;
+        } else if (number) {
+            *number = line.toLongLong();
+            number = nullptr;
+        } else if (list) {
+            list->append(QString::fromUtf8(line));
+        }
+    }
+}
+} // namespace
+
+QJsonObject SyncPackage::toJson() const {
+    QJsonObject record;
+    record[QStringLiteral("name")] = name;
+    record[QStringLiteral("version")] = version;
+    record[QStringLiteral("repo")] = repository;
+    record[QStringLiteral("description")] = description;
+    record[QStringLiteral("filename")] = fileName;
+    record[QStringLiteral("download_size")] = downloadSize;
+    record[QStringLiteral("installed_size")] = installedSize;
+    record[QStringLiteral("groups")] = QJsonArray::fromStringList(groups);
+    record[QStringLiteral("depends")] = QJsonArray::fromStringList(depends);
+    record[QStringLiteral("replaces")] = QJsonArray::fromStringList(replaces);
+    record[QStringLiteral("conflicts")] = QJsonArray::fromStringList(conflicts);
+    record[QStringLiteral("provides")] = QJsonArray::fromStringList(provides);
+    return record;
+}
+
+QJsonObject PendingRemoval::toJson() const {
+    QJsonObject record;
+    record[QStringLiteral("name")] = name;
+    record[QStringLiteral("reason")] = reason;
+    record[QStringLiteral("by")] = by;
+    return record;
+}
+
+QList<SyncPackage> readSyncDb(const QString& path, const QString& repository, QString* error) {
+    QList<SyncPackage> packages;
+    archive* reader = archive_read_new();
+    archive_read_support_filter_all(reader);
+    archive_read_support_format_tar(reader);
+    if (archive_read_open_filename(reader, QFile::encodeName(path).constData(), 64 * 1024) != ARCHIVE_OK) {
+        if (error) {
+            *error = archiveError(reader);
+        }
+        archive_read_free(reader);
+        return packages;
+    }
+
+    // Entries are "<name>-<version>/desc"; older databases split some fields
+    // into "<name>-<version>/depends"
+    QHash<QString, qsizetype> byEntry;
+    archive_entry* entry = nullptr;
+    QByteArray data;
+    QByteArray chunk(64 * 1024, Qt::Uninitialized);
+    QString readError;
+    int status;
+    while ((status = archive_read_next_header(reader, &entry)) == ARCHIVE_OK) {
+        const QString entryPath = QString::fromUtf8(archive_entry_pathname(entry));
+        const QString file = entryPath.section(u'/', -1);
+        if (file != QStringLiteral("desc") && file != QStringLiteral("depends")) {
+            continue;
+        }
+        // An entry can span several reads (and its size may not be known)
+        data.clear();
+        data.reserve(archive_entry_size(entry));
+        la_ssize_t read;
+        while ((read = archive_read_data(reader, chunk.data(), chunk.size())) > 0) {
+            data.append(chunk.constData(), read);
+        }
+        if (read < 0) {
+            readError = archiveError(reader);
+            break;
+        }
+
+        const QString dirName = entryPath.section(u'/', 0, 0);
+        auto it = byEntry.constFind(dirName);
+        if (it == byEntry.cend()) {
+            it = byEntry.insert(dirName, packages.size());
+            packages.append(SyncPackage());
+            packages.last().repository = repository;
+        }
+        parseDescFile(data, packages[it.value()]);
+    }
+    if (readError.isEmpty() && status != ARCHIVE_EOF) {
+        readError = archiveError(reader);
+    }
+    archive_read_free(reader);
+    if (!readError.isEmpty()) {
+        // A partly read database would look like packages were dropped
+        if (error) {
+            *error = readError;
+        }
+        packages.clear();
+    }
+    return packages;
+}
+
+QList<SyncPackage> readSyncDbs(const QString& dbPath, const QStringList& repos, QString* error) {
+    // Decompression dominates, and each database is an independent archive
+    const QDir syncDir(QDir(dbPath).filePath(QStringLiteral("sync")));
+    QList<QList<SyncPackage>> perRepo(repos.size());
+    QStringList errors(repos.size());
+    QList<QThread*> workers;
+    for (qsizetype i = 0; i < repos.size(); ++i) {
+        const QString path = syncDir.filePath(repos[i] + QStringLiteral(".db"));
+        QList<SyncPackage>* result = &perRepo[i];
+        QString* repoError = &errors[i];
+        const QString repo = repos[i];
+        workers.append(QThread::create([path, repo, result, repoError]() {
+            *result = readSyncDb(path, repo, repoError);
+        }));
+        workers.last()->start();
+    }
+
+    QList<SyncPackage> packages;
+    QString firstError;
+    for (qsizetype i = 0; i < workers.size(); ++i) {
+        workers[i]->wait();
+        delete workers[i];
+        if (!errors[i].isEmpty()) {
+            qWarning() << "Cannot read sync database" << repos[i] << ":" << errors[i];
+            if (firstError.isEmpty()) {
+                firstError = repos[i] + QStringLiteral(": ") + errors[i];
+            }
+        }
+        packages += perRepo[i];
+    }
+    if (!firstError.isEmpty()) {
+        if (error) {
+            *error = firstError;
+        }
+        return QList<SyncPackage>();
+    }
+    return packages;
+}
+
+QHash<QString, QString> readLocalPackages(const QString& localDbDir) {
+    QHash<QString, QString> installed;
+    const QStringList entries = QDir(localDbDir).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    installed.reserve(entries.size());
+    QString name;
+    QString version;
+    for (const QString& entry : entries) {
+        if (splitLocalEntry(entry, name, version)) {
+            installed.insert(name, version);
+        }
+    }
+    return installed;
+}
+
+bool splitLocalEntry(const QString& entry, QString& name, QString& version) {
+    // Entry directories are "<name>-<pkgver>-<pkgrel>"; names may contain dashes
+    name = entry.section(u'-', 0, -3);
+    version = entry.section(u'-', -2);
+    return !name.isEmpty();
+}
+
+QString dependencyName(const QString& depend) {
+    qsizetype end = 0;
+    while (end < depend.size() && depend[end] != u'<' && depend[end] != u'>' && depend[end] != u'=') {
+        ++end;
+    }
+    return depend.left(end);
+}
+
+bool versionSatisfies(const QString& depend, const QString& version) {
+    const QString name = dependencyName(depend);
+    if (name.size() == depend.size()) {
+        return true;
+    }
+    QStringView constraint = QStringView(depend).sliced(name.size());
+    QStringView op = constraint.first(constraint.size() > 1 && constraint[1] == u'=' ? 2 : 1);
+    const int cmp = vercmp(version, constraint.sliced(op.size()));
+    if (op == u"<") {
+        return cmp < 0;
+    }
+    if (op == u"<=") {
+        return cmp <= 0;
+    }
+    if (op == u"=") {
+        return cmp == 0;
+    }
+    if (op == u">=") {
+        return cmp >= 0;
+    }
+    return op == u">" && cmp > 0;
+}
+
+QList<PendingRemoval> findPendingRemovals(const QList<SyncPackage>& syncPackages,
+                                          const QHash<QString, QString>& installed,
+                                          const QSet<QString>& upgradeTargets) {
+    QList<PendingRemoval> removals;
+    // A conflict is with the package as the upgrade leaves it: the new
+    // version when it is upgraded too, the installed one otherwise. Replaces
+    // are matched against the installed version, as pacman does before it
+    // upgrades anything.
+    QHash<QString, QString> upgradedVersions;
+    for (const SyncPackage& package : syncPackages) {
+        if (upgradeTargets.contains(package.name) && !upgradedVersions.contains(package.name)) {
+            upgradedVersions.insert(package.name, package.version);
+        }
+    }
+    QSet<QString> seenPackages;
+    QSet<QString> removed;
+    for (const SyncPackage& package : syncPackages) {
+        if (seenPackages.contains(package.name)) {
+            continue; // Shadowed by an earlier repository
+        }
+        seenPackages.insert(package.name);
+
+        if (!installed.contains(package.name)) {
+            for (const QString& replaces : package.replaces) {
+                const QString name = dependencyName(replaces);
+                if (name != package.name && installed.contains(name) && !removed.contains(name)
+                    && versionSatisfies(replaces, installed.value(name))) {
+                    removals.append({name, QStringLiteral("replaced"), package.name});
+                    removed.insert(name);
+                }
+            }
+        } else if (upgradeTargets.contains(package.name)) {
+            for (const QString& conflict : package.conflicts) {
+                const QString name = dependencyName(conflict);
+                if (name != package.name && installed.contains(name) && !removed.contains(name)
+                    && versionSatisfies(conflict, upgradedVersions.value(name, installed.value(name)))) {
+                    removals.append({name, QStringLiteral("conflict"), package.name});
+                    removed.insert(name);
+                }
+            }
+        }
+    }
+    return removals;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+// Fields of one package entry in a sync database
+struct SyncPackage {
+    QString name;
+    QString version;
+    QString repository;
+    QString description;
+    QString fileName;
+    qint64 downloadSize = 0;  // %CSIZE%
+    qint64 installedSize = 0; // %ISIZE%
+    QStringList groups;
+    QStringList depends;   // Dependency strings, e.g. "foo" or "foo<2.0"
+    QStringList replaces;
+    QStringList conflicts;
+    QStringList provides;
+
+    QJsonObject toJson() const;
+};
+
+// An installed package an upgrade would take away
+struct PendingRemoval {
+    QString name;   // Installed package
+    QString reason; // "replaced" or "conflict"
+    QString by;     // Sync package that replaces or conflicts with it
+
+    QJsonObject toJson() const;
+};
+
+// Reads every package entry of a sync database (repo.db, a tar archive in any
+// compression pacman supports) in-process. Returns an empty list and sets
+// error when the file cannot be read.
+QList<SyncPackage> readSyncDb(const QString& path, const QString& repository, QString* error = nullptr);
+// Reads <dbPath>/sync/<repo>.db for every repo, one thread per repository,
+// and returns the packages in repository order. If any database cannot be
+// read, returns an empty list and sets error.
+QList<SyncPackage> readSyncDbs(const QString& dbPath, const QStringList& repos, QString* error = nullptr);
+
+// Installed packages (name -> version) from the entry names of the local DB
+// directory, without reading any entry
+QHash<QString, QString> readLocalPackages(const QString& localDbDir);
+// Splits a local DB entry name into package name and version; false if it
+// is not one
+bool splitLocalEntry(const QString& entry, QString& name, QString& version);
+
+// Package name of a dependency string ("foo>=1.0" -> "foo")
+QString dependencyName(const QString& depend);
+// Whether a package at version satisfies the version constraint of depend
+// (names are not compared); unversioned dependencies always match
+bool versionSatisfies(const QString& depend, const QString& version);
+
+// Installed packages that an upgrade would remove: those matched (name and
+// installed version) by the %REPLACES% of a sync package that is not
+// installed, and those matched by the %CONFLICTS% of a pending upgrade target,
+// at the version the upgrade leaves them (their new one if they are upgrade
+// targets too). Sync packages are given in repository order; the first
+// repository that has a package wins.
+QList<PendingRemoval> findPendingRemovals(const QList<SyncPackage>& syncPackages,
+                                          const QHash<QString, QString>& installed,
+                                          const QSet<QString>& upgradeTargets);
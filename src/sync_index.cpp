@@ -0,0 +1,339 @@
+#include "sync_index.h"
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <cstring>
+#include <limits>
+
+namespace {
+constexpr char INDEX_MAGIC[8] = {'U', 'N', 'Q', 'S', 'I', 'D', 'X', '\0'};
+constexpr quint32 INDEX_VERSION = 1;
+
+enum Field {
+    FieldName,
+    FieldVersion,
+    FieldRepository,
+    FieldDescription,
+    FieldFileName,
+    FieldGroups, // List fields are joined with '\n'
+    FieldDepends,
+    FieldReplaces,
+    FieldConflicts,
+    FieldProvides,
+    FieldCount
+};
+
+// FNV-1a over the UTF-8 package name
+quint64 nameHash(QByteArrayView name) {
+    quint64 hash = 14695981039346656037ULL;
+    for (char c : name) {
+        hash ^= static_cast<uchar>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Whether [offset, offset + length) lies inside a file of the given size,
+// without overflowing on corrupt offsets
+bool fitsIn(quint64 offset, quint64 length, quint64 size) {
+    return offset <= size && length <= size - offset;
+}
+
+quint64 alignTo8(quint64 offset) {
+    return (offset + 7) & ~quint64(7);
+}
+
+QStringList splitList(QByteArrayView value) {
+    QStringList list;
+    if (value.isEmpty()) {
+        return list;
+    }
+    for (const QByteArray& item : value.toByteArray().split('\n')) {
+        list.append(QString::fromUtf8(item));
+    }
+    return list;
+}
+} // namespace
+
+// The file is only ever read on the machine that wrote it, so it uses native
+// byte order and layout; a format change bumps INDEX_VERSION and the stale
+// file is rebuilt
+struct SyncIndex::Header {
+    char magic[8];
+    quint32 version;
+    quint32 recordCount;
+    quint32 bucketCount; // Power of two; a bucket holds record index + 1, 0 if empty
+    quint32 fingerprintSize;
+    char fingerprint[64];
+    quint64 bucketsOffset;
+    quint64 recordsOffset;
+    quint64 stringsOffset;
+    quint64 stringsSize;
+};
+
+struct SyncIndex::Record {
+    quint32 fieldOffset[FieldCount]; // Into the string blob
+    quint32 fieldSize[FieldCount];
+    qint64 downloadSize;
+    qint64 installedSize;
+};
+
+SyncIndex::~SyncIndex() {
+    close();
+}
+
+bool SyncIndex::open(const QString& path) {
+    close();
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    dataSize = file.size();
+    if (dataSize < static_cast<qint64>(sizeof(Header))) {
+        close();
+        return false;
+    }
+    data = file.map(0, dataSize);
+    if (!data) {
+        qWarning() << "Cannot map sync index" << path << ":" << file.errorString();
+        close();
+        return false;
+    }
+
+    const Header* header = reinterpret_cast<const Header*>(data);
+    const quint64 size = static_cast<quint64>(dataSize);
+    const bool valid = std::memcmp(header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0 &&
+                       header->version == INDEX_VERSION &&
+                       header->fingerprintSize <= sizeof(header->fingerprint) &&
+                       header->bucketCount > 0 && (header->bucketCount & (header->bucketCount - 1)) == 0 &&
+                       header->recordCount < header->bucketCount &&
+                       header->bucketsOffset % alignof(quint32) == 0 &&
+                       fitsIn(header->bucketsOffset, quint64(header->bucketCount) * sizeof(quint32), size) &&
+                       header->recordsOffset % alignof(Record) == 0 &&
+                       fitsIn(header->recordsOffset, quint64(header->recordCount) * sizeof(Record), size) &&
+                       fitsIn(header->stringsOffset, header->stringsSize, size);
+    if (!valid) {
+        qWarning() << "Ignoring invalid sync index" << path;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SyncIndex::close() {
+    if (data) {
+        file.unmap(const_cast<uchar*>(data));
+    }
+    data = nullptr;
+    dataSize = 0;
+    file.close();
+}
+
+QString SyncIndex::fingerprint() const {
+    if (!data) {
+        return QString();
+    }
+    const Header* header = reinterpret_cast<const Header*>(data);
+    return QString::fromLatin1(header->fingerprint, header->fingerprintSize);
+}
+
+qsizetype SyncIndex::size() const {
+    return data ? reinterpret_cast<const Header*>(data)->recordCount : 0;
+}
+
+const SyncIndex::Record* SyncIndex::lookup(QByteArrayView name) const {
+    if (!data) {
+        return nullptr;
+    }
+    const Header* header = reinterpret_cast<const Header*>(data);
+    const quint32* buckets = reinterpret_cast<const quint32*>(data + header->bucketsOffset);
+    const Record* records = reinterpret_cast<const Record*>(data + header->recordsOffset);
+    const quint32 mask = header->bucketCount - 1;
+    // The table is written at most half full, so a probe sequence ends at an
+    // empty bucket; the step bound only matters for a corrupt file
+    quint32 slot = static_cast<quint32>(nameHash(name)) & mask;
+    for (quint32 step = 0; step < header->bucketCount; ++step, slot = (slot + 1) & mask) {
+        const quint32 entry = buckets[slot];
+        if (entry == 0 || entry > header->recordCount) {
+            return nullptr;
+        }
+        const Record* record = &records[entry - 1];
+        if (field(record, FieldName) == name) {
+            return record;
+        }
+    }
+    return nullptr;
+}
+
+QByteArrayView SyncIndex::field(const Record* record, int index) const {
+    const Header* header = reinterpret_cast<const Header*>(data);
+    const quint64 offset = record->fieldOffset[index];
+    const quint64 size = record->fieldSize[index];
+    if (offset + size > header->stringsSize) {
+        return QByteArrayView();
+    }
+    return QByteArrayView(reinterpret_cast<const char*>(data + header->stringsOffset + offset),
+                          static_cast<qsizetype>(size));
+}
+
+SyncPackage SyncIndex::toPackage(const Record* record) const {
+    SyncPackage package;
+    package.name = QString::fromUtf8(field(record, FieldName));
+    package.version = QString::fromUtf8(field(record, FieldVersion));
+    package.repository = QString::fromUtf8(field(record, FieldRepository));
+    package.description = QString::fromUtf8(field(record, FieldDescription));
+    package.fileName = QString::fromUtf8(field(record, FieldFileName));
+    package.downloadSize = record->downloadSize;
+    package.installedSize = record->installedSize;
+    package.groups = splitList(field(record, FieldGroups));
+    package.depends = splitList(field(record, FieldDepends));
+    package.replaces = splitList(field(record, FieldReplaces));
+    package.conflicts = splitList(field(record, FieldConflicts));
+    package.provides = splitList(field(record, FieldProvides));
+    return package;
+}
+
+std::optional<SyncPackage> SyncIndex::find(const QString& name) const {
+    const Record* record = lookup(name.toUtf8());
+    if (!record) {
+        return std::nullopt;
+    }
+    return toPackage(record);
+}
+
+QString SyncIndex::version(const QString& name) const {
+    const Record* record = lookup(name.toUtf8());
+    return record ? QString::fromUtf8(field(record, FieldVersion)) : QString();
+}
+
+QList<SyncPackage> SyncIndex::packages() const {
+    QList<SyncPackage> result;
+    if (!data) {
+        return result;
+    }
+    const Header* header = reinterpret_cast<const Header*>(data);
+    const Record* records = reinterpret_cast<const Record*>(data + header->recordsOffset);
+    result.reserve(header->recordCount);
+    for (quint32 i = 0; i < header->recordCount; ++i) {
+        result.append(toPackage(&records[i]));
+    }
+    return result;
+}
+
+QSet<QString> SyncIndex::diff(const QList<SyncPackage>& packages) const {
+    QSet<QString> changed;
+    QSet<QString> seen;
+    seen.reserve(packages.size());
+    for (const SyncPackage& package : packages) {
+        if (seen.contains(package.name)) {
+            continue; // Shadowed by an earlier repository, as in the index
+        }
+        seen.insert(package.name);
+        const Record* record = lookup(package.name.toUtf8());
+        if (!record || field(record, FieldVersion) != package.version.toUtf8() ||
+            field(record, FieldRepository) != package.repository.toUtf8()) {
+            changed.insert(package.name);
+        }
+    }
+    if (data) {
+        const Header* header = reinterpret_cast<const Header*>(data);
+        const Record* records = reinterpret_cast<const Record*>(data + header->recordsOffset);
+        for (quint32 i = 0; i < header->recordCount; ++i) {
+            const QString name = QString::fromUtf8(field(&records[i], FieldName));
+            if (!seen.contains(name)) {
+                changed.insert(name);
+            }
+        }
+    }
+    return changed;
+}
+
+bool SyncIndex::write(const QString& path, const QString& fingerprint, const QList<SyncPackage>& packages) {
+    QList<Record> records;
+    QByteArray strings;
+    QSet<QString> indexed;
+    QList<quint64> hashes;
+    records.reserve(packages.size());
+
+    bool overflow = false;
+    auto addString = [&strings, &overflow](Record& record, int index, const QString& value) {
+        const QByteArray utf8 = value.toUtf8();
+        if (strings.size() + utf8.size() > std::numeric_limits<quint32>::max()) {
+            overflow = true;
+            return;
+        }
+        record.fieldOffset[index] = static_cast<quint32>(strings.size());
+        record.fieldSize[index] = static_cast<quint32>(utf8.size());
+        strings.append(utf8);
+    };
+    const QString separator = QStringLiteral("\n");
+    for (const SyncPackage& package : packages) {
+        if (indexed.contains(package.name)) {
+            continue;
+        }
+        indexed.insert(package.name);
+        Record record = {};
+        addString(record, FieldName, package.name);
+        addString(record, FieldVersion, package.version);
+        addString(record, FieldRepository, package.repository);
+        addString(record, FieldDescription, package.description);
+        addString(record, FieldFileName, package.fileName);
+        addString(record, FieldGroups, package.groups.join(separator));
+        addString(record, FieldDepends, package.depends.join(separator));
+        addString(record, FieldReplaces, package.replaces.join(separator));
+        addString(record, FieldConflicts, package.conflicts.join(separator));
+        addString(record, FieldProvides, package.provides.join(separator));
+        record.downloadSize = package.downloadSize;
+        record.installedSize = package.installedSize;
+        records.append(record);
+        hashes.append(nameHash(package.name.toUtf8()));
+    }
+    const QByteArray fingerprintBytes = fingerprint.toLatin1();
+    if (overflow || fingerprintBytes.size() > static_cast<qsizetype>(sizeof(Header::fingerprint))) {
+        qWarning() << "Cannot build sync index: data out of range";
+        return false;
+    }
+
+    quint32 bucketCount = 16;
+    while (bucketCount < static_cast<quint64>(records.size()) * 2) {
+        bucketCount *= 2;
+    }
+    QList<quint32> buckets(bucketCount, 0);
+    for (qsizetype i = 0; i < records.size(); ++i) {
+        quint32 slot = static_cast<quint32>(hashes[i]) & (bucketCount - 1);
+        while (buckets[slot] != 0) {
+            slot = (slot + 1) & (bucketCount - 1);
+        }
+        buckets[slot] = static_cast<quint32>(i + 1);
+    }
+
+    Header header = {};
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    header.recordCount = static_cast<quint32>(records.size());
+    header.bucketCount = bucketCount;
+    header.fingerprintSize = static_cast<quint32>(fingerprintBytes.size());
+    std::memcpy(header.fingerprint, fingerprintBytes.constData(), fingerprintBytes.size());
+    header.bucketsOffset = sizeof(Header);
+    header.recordsOffset = alignTo8(header.bucketsOffset + quint64(bucketCount) * sizeof(quint32));
+    header.stringsOffset = header.recordsOffset + quint64(records.size()) * sizeof(Record);
+    header.stringsSize = static_cast<quint64>(strings.size());
+
+    QByteArray image;
+    image.reserve(static_cast<qsizetype>(header.stringsOffset + header.stringsSize));
+    image.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    image.append(reinterpret_cast<const char*>(buckets.constData()), buckets.size() * sizeof(quint32));
+    image.append(static_cast<qsizetype>(header.recordsOffset) - image.size(), '\0');
+    image.append(reinterpret_cast<const char*>(records.constData()), records.size() * sizeof(Record));
+    image.append(strings);
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly) || out.write(image) != image.size() || !out.commit()) {
+        qWarning() << "Cannot write sync index" << path << ":" << out.errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QFile>
+#include <QList>
+#include <QSet>
+#include <QString>
+
+#include <optional>
+
+#include "common.h"
+#include "sync_db.h"
+
+const QString SYNC_INDEX_PATH = STATE_DIR_PATH + QStringLiteral("/sync-index.bin");
+
+// Decoded sync databases in a flat file that is mapped instead of parsed:
+// a header, an open-addressing hash table keyed by package name, fixed-size
+// records and one string blob. Decompressing and parsing the *.db archives
+// happens once per sync; afterwards every lookup is a hash probe into the
+// mapping, also across daemon restarts, until the sync DB fingerprint changes.
+// Packages in several repositories are indexed once, from the first repo in
+// pacman.conf order, as pacman resolves them.
+class SyncIndex {
+public:
+    SyncIndex() = default;
+    SyncIndex(const SyncIndex&) = delete;
+    SyncIndex& operator=(const SyncIndex&) = delete;
+    ~SyncIndex();
+
+    // Maps the index at path; fails (and stays closed) on a missing, truncated
+    // or foreign-format file
+    bool open(const QString& path);
+    void close();
+    bool isOpen() const { return data != nullptr; }
+    // Sync DB fingerprint the index was built from, empty when closed
+    QString fingerprint() const;
+    qsizetype size() const;
+
+    std::optional<SyncPackage> find(const QString& name) const;
+    QString version(const QString& name) const;
+    QList<SyncPackage> packages() const;
+    // Names whose version or repository differs between this index and
+    // packages, including names present on one side only
+    QSet<QString> diff(const QList<SyncPackage>& packages) const;
+
+    // Writes a new index atomically (temporary file plus rename)
+    static bool write(const QString& path, const QString& fingerprint, const QList<SyncPackage>& packages);
+
+private:
+    struct Header;
+    struct Record;
+
+    const Record* lookup(QByteArrayView name) const;
+    QByteArrayView field(const Record* record, int index) const;
+    SyncPackage toPackage(const Record* record) const;
+
+    QFile file;
+    const uchar* data = nullptr;
+    qint64 dataSize = 0;
+};
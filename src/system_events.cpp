@@ -0,0 +1,216 @@
+#include "system_events.h"
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDBusServiceWatcher>
+#include <QDBusVariant>
+#include <QDebug>
+#include <QFile>
+#include <QSocketNotifier>
+#include <QStringTokenizer>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+constexpr int DBUS_TIMEOUT_MS = 2000;
+
+const QString PROPERTIES_INTERFACE = QStringLiteral("org.freedesktop.DBus.Properties");
+const QString NM_SERVICE = QStringLiteral("org.freedesktop.NetworkManager");
+const QString NM_PATH = QStringLiteral("/org/freedesktop/NetworkManager");
+const QString UPOWER_SERVICE = QStringLiteral("org.freedesktop.UPower");
+const QString UPOWER_PATH = QStringLiteral("/org/freedesktop/UPower");
+constexpr uint NM_STATE_CONNECTED_GLOBAL = 70;
+// NMMetered: YES and GUESS_YES
+constexpr uint NM_METERED_YES = 1;
+constexpr uint NM_METERED_GUESS_YES = 3;
+
+// Route flags from <linux/route.h>
+constexpr uint RTF_UP_FLAG = 0x0001;
+constexpr uint RTF_REJECT_FLAG = 0x0200;
+} // namespace
+
+SystemEvents::SystemEvents(QObject* parent)
+    : SystemEvents(QDBusConnection::systemBus(), parent)
+{
+}
+
+SystemEvents::SystemEvents(const QDBusConnection& bus, QObject* parent)
+    : QObject(parent)
+    , bus(bus)
+    , online(hasDefaultRoute())
+{
+    this->bus.connect(QStringLiteral("org.freedesktop.login1"), QStringLiteral("/org/freedesktop/login1"),
+                      QStringLiteral("org.freedesktop.login1.Manager"), QStringLiteral("PrepareForSleep"), this,
+                      SLOT(onPrepareForSleep(bool)));
+    // Connected even when the services are not running yet; signals arrive
+    // once they are, and the watcher fetches their properties then
+    this->bus.connect(NM_SERVICE, NM_PATH, NM_SERVICE, QStringLiteral("StateChanged"), this,
+                      SLOT(onNetworkManagerStateChanged(uint)));
+    for (const auto& [service, path] : {std::pair{NM_SERVICE, NM_PATH}, std::pair{UPOWER_SERVICE, UPOWER_PATH}}) {
+        this->bus.connect(service, path, PROPERTIES_INTERFACE, QStringLiteral("PropertiesChanged"), this,
+                          SLOT(onPropertiesChanged(QString, QVariantMap, QStringList)));
+    }
+    auto* watcher = new QDBusServiceWatcher(this);
+    watcher->setConnection(this->bus);
+    watcher->setWatchMode(QDBusServiceWatcher::WatchForRegistration | QDBusServiceWatcher::WatchForUnregistration);
+    watcher->addWatchedService(NM_SERVICE);
+    watcher->addWatchedService(UPOWER_SERVICE);
+    connect(watcher, &QDBusServiceWatcher::serviceRegistered, this, &SystemEvents::requestProperties);
+    connect(watcher, &QDBusServiceWatcher::serviceUnregistered, this, [this](const QString& service) {
+        // A service that is not running defers nothing
+        if (service == UPOWER_SERVICE) {
+            battery = false;
+        } else {
+            metered = false;
+            setOnline(hasDefaultRoute());
+        }
+    });
+
+    if (networkManagerRunning()) {
+        requestProperties(NM_SERVICE);
+    } else {
+        watchRoutes();
+    }
+    requestProperties(UPOWER_SERVICE);
+}
+
+SystemEvents::~SystemEvents() {
+    if (netlinkFd >= 0) {
+        ::close(netlinkFd);
+    }
+}
+
+void SystemEvents::onPrepareForSleep(bool start) {
+    if (!start) {
+        qWarning() << "System resumed";
+        emit resumed();
+    }
+}
+
+void SystemEvents::onNetworkManagerStateChanged(uint state) {
+    setOnline(state == NM_STATE_CONNECTED_GLOBAL);
+}
+
+void SystemEvents::onPropertiesChanged(const QString& interface, const QVariantMap& changed,
+                                       const QStringList& invalidated) {
+    for (auto it = changed.cbegin(); it != changed.cend(); ++it) {
+        applyProperty(interface, it.key(), it.value());
+    }
+    if (!invalidated.isEmpty()) {
+        requestProperties(interface);
+    }
+}
+
+void SystemEvents::requestProperties(const QString& service) {
+    if (service == NM_SERVICE) {
+        requestProperty(NM_SERVICE, NM_PATH, NM_SERVICE, QStringLiteral("State"));
+        requestProperty(NM_SERVICE, NM_PATH, NM_SERVICE, QStringLiteral("Metered"));
+    } else if (service == UPOWER_SERVICE) {
+        requestProperty(UPOWER_SERVICE, UPOWER_PATH, UPOWER_SERVICE, QStringLiteral("OnBattery"));
+    }
+}
+
+void SystemEvents::requestProperty(const QString& service, const QString& path, const QString& interface,
+                                   const QString& property) {
+    QDBusMessage message = QDBusMessage::createMethodCall(service, path, PROPERTIES_INTERFACE, QStringLiteral("Get"));
+    message << interface << property;
+    auto* watcher = new QDBusPendingCallWatcher(bus.asyncCall(message, DBUS_TIMEOUT_MS), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this,
+            [this, interface, property](QDBusPendingCallWatcher* call) {
+        const QDBusPendingReply<QDBusVariant> reply = *call;
+        // Not running (or no such property): keep the default, which defers nothing
+        if (!reply.isError()) {
+            applyProperty(interface, property, reply.value().variant());
+        }
+        call->deleteLater();
+    });
+}
+
+void SystemEvents::applyProperty(const QString& interface, const QString& property, const QVariant& value) {
+    if (interface == NM_SERVICE && property == QStringLiteral("State")) {
+        setOnline(value.toUInt() == NM_STATE_CONNECTED_GLOBAL);
+    } else if (interface == NM_SERVICE && property == QStringLiteral("Metered")) {
+        const uint state = value.toUInt();
+        metered = state == NM_METERED_YES || state == NM_METERED_GUESS_YES;
+    } else if (interface == UPOWER_SERVICE && property == QStringLiteral("OnBattery")) {
+        battery = value.toBool();
+    }
+}
+
+void SystemEvents::setOnline(bool nowOnline) {
+    if (nowOnline && !online) {
+        qWarning() << "Network online";
+        emit networkOnline();
+    }
+    online = nowOnline;
+}
+
+void SystemEvents::watchRoutes() {
+    netlinkFd = ::socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_ROUTE);
+    if (netlinkFd < 0) {
+        qWarning() << "Cannot open rtnetlink socket, network-online events unavailable";
+        return;
+    }
+    sockaddr_nl addr = {};
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = RTMGRP_IPV4_ROUTE | RTMGRP_IPV6_ROUTE;
+    if (::bind(netlinkFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        qWarning() << "Cannot bind rtnetlink socket, network-online events unavailable";
+        ::close(netlinkFd);
+        netlinkFd = -1;
+        return;
+    }
+    routeNotifier = new QSocketNotifier(netlinkFd, QSocketNotifier::Read, this);
+    connect(routeNotifier, &QSocketNotifier::activated, this, &SystemEvents::onRouteMessages);
+}
+
+void SystemEvents::onRouteMessages() {
+    // The messages only say that routes changed; the routing table tells whether
+    // there is a default route now
+    char buffer[8192];
+    while (::recv(netlinkFd, buffer, sizeof(buffer), 0) > 0) {
+    }
+    setOnline(hasDefaultRoute());
+}
+
+bool SystemEvents::networkManagerRunning() const {
+    QDBusConnectionInterface* busInterface = bus.interface();
+    return busInterface && busInterface->isServiceRegistered(NM_SERVICE).value();
+}
+
+bool SystemEvents::hasDefaultRoute() {
+    // /proc/net/route: "Iface Destination Gateway Flags ..." in hex
+    QFile ipv4(QStringLiteral("/proc/net/route"));
+    if (ipv4.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        const QString content = QString::fromLatin1(ipv4.readAll());
+        for (QStringView line : QStringTokenizer{content, u'\n', Qt::SkipEmptyParts}) {
+            const QList<QStringView> fields = line.split(u'\t', Qt::SkipEmptyParts);
+            if (fields.size() > 3 && fields[1] == u"00000000"
+                && (fields[3].toUInt(nullptr, 16) & RTF_UP_FLAG)) {
+                return true;
+            }
+        }
+    }
+    // /proc/net/ipv6_route: "dest plen src splen nexthop metric refcnt use flags iface"
+    QFile ipv6(QStringLiteral("/proc/net/ipv6_route"));
+    if (ipv6.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        const QString content = QString::fromLatin1(ipv6.readAll());
+        for (QStringView line : QStringTokenizer{content, u'\n', Qt::SkipEmptyParts}) {
+            const QList<QStringView> fields = line.split(u' ', Qt::SkipEmptyParts);
+            if (fields.size() < 10 || fields[1] != u"00" || fields[9] == u"lo") {
+                continue;
+            }
+            const uint flags = fields[8].toUInt(nullptr, 16);
+            if (fields[0] == QStringView(u"00000000000000000000000000000000") && (flags & RTF_UP_FLAG)
+                && !(flags & RTF_REJECT_FLAG)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QDBusConnection>
+#include <QObject>
+#include <QVariant>
+#include <QVariantMap>
+
+class QDBusPendingCallWatcher;
+class QSocketNotifier;
+
+// System state the monitor reacts to: resume from suspend (logind
+// PrepareForSleep) and the network coming online (NetworkManager StateChanged,
+// or rtnetlink route changes when NetworkManager is not running). The
+// properties the check gate asks about (online, metered, on battery) are kept
+// from the services' PropertiesChanged signals, so reading them never blocks
+// the event loop; they are fetched asynchronously whenever a service appears.
+class SystemEvents : public QObject {
+    Q_OBJECT
+
+public:
+    explicit SystemEvents(QObject* parent = nullptr);
+    // UPower and NetworkManager on bus instead of the system bus (tests)
+    SystemEvents(const QDBusConnection& bus, QObject* parent = nullptr);
+    ~SystemEvents() override;
+
+    bool isOnline() const { return online; }
+    bool isMetered() const { return metered; }
+    bool onBattery() const { return battery; }
+
+Q_SIGNALS:
+    void resumed();
+    void networkOnline();
+
+private Q_SLOTS:
+    void onPrepareForSleep(bool start);
+    void onNetworkManagerStateChanged(uint state);
+    void onPropertiesChanged(const QString& interface, const QVariantMap& changed, const QStringList& invalidated);
+    void onRouteMessages();
+
+private:
+    void requestProperties(const QString& service);
+    void requestProperty(const QString& service, const QString& path, const QString& interface,
+                         const QString& property);
+    void applyProperty(const QString& interface, const QString& property, const QVariant& value);
+    void setOnline(bool nowOnline);
+    bool networkManagerRunning() const;
+    static bool hasDefaultRoute();
+    void watchRoutes();
+
+    QDBusConnection bus;
+    bool online;
+    bool metered = false;
+    bool battery = false;
+    int netlinkFd = -1;
+    QSocketNotifier* routeNotifier = nullptr;
+};
@@ -1,104 +1,419 @@
 #include "system_monitor.h"
 #include "common.h"
+#include "pacman_db.h"
+#include "sync_db.h"
+#include <QCoreApplication>
 #include <QDebug>
 #include <QJsonArray>
+#include <QHash>
+#include <QMap>
+#include <QSaveFile>
 #include <QDateTime>
 #include <QThread>
 #include <QStringTokenizer>
 #include <QStringView>
-#include <QStandardPaths>
 #include <QDBusInterface>
+#include <fnmatch.h>
+#include <optional>
+
+// Default for Settings/lock_wait_timeout: long enough for a large upgrade
+constexpr int DEFAULT_LOCK_WAIT_TIMEOUT = 3600;
+// Default for Settings/aur_check_interval: the AUR is rate limited and its
+// versions move slower than the repos
+constexpr int DEFAULT_AUR_CHECK_INTERVAL = 6 * 60 * 60;
+const QString AUR_CACHE_PATH = STATE_DIR_PATH + QStringLiteral("/aur-cache.json");
+const QString DEVEL_CACHE_PATH = STATE_DIR_PATH + QStringLiteral("/devel.json");
+// Default for Settings/devel_allowed_protocols (GIT_ALLOW_PROTOCOL syntax); no
+// ssh or file access from the root daemon unless configured
+const QString DEFAULT_DEVEL_ALLOWED_PROTOCOLS = QStringLiteral("https:http:git");
+// Settle time after resume or a network change before a due check starts
+constexpr int EVENT_CHECK_DELAY_MS = 3000;
+// Prefetch status changes published together at most this often
+constexpr int PREFETCH_PUBLISH_DELAY_MS = 15000;
+
+namespace {
+QStringList splitOutputLines(const QString& output) {
+    QStringList lines;
+    lines.reserve(output.count(QLatin1Char('\n')) + 1);
+    for (QStringView lineView : QStringTokenizer{output, u'\n', Qt::SkipEmptyParts}) {
+        lineView = lineView.trimmed();
+        if (!lineView.isEmpty()) {
+            lines.append(lineView.toString());
+        }
+    }
+    return lines;
+}
 
-const QRegularExpression SystemMonitor::UPDATE_RE = QRegularExpression(QStringLiteral(R"(^(\S+)\s+(\S+)\s+->\s+(\S+))"));
+// Identifies the pending set (names and new versions) of a state, ignoring
+// everything else a check rewrites
+QString pendingUpdatesKey(const QJsonObject& state) {
+    QStringList entries;
+    for (const QString& key : {QStringLiteral("packages"), QStringLiteral("aur_packages")}) {
+        for (const QJsonValue& value : state[key].toArray()) {
+            const PackageUpdate update = PackageUpdate::fromJson(value);
+            entries.append(update.name + QLatin1Char(' ') + update.newVersion);
+        }
+    }
+    return entries.join(QLatin1Char('\n'));
+}
+} // namespace
 
-SystemMonitor::SystemMonitor(bool requireChecksum)
+SystemMonitor::SystemMonitor(bool requireChecksum, bool useAlpm, int idleTimeout)
     : QObject()
     , requireChecksum(requireChecksum)
-    , cachedStateJson()
-    , lastStateChange(0)
-    , cachedSummaryJson()
-    , lastSummaryChange(0)
     , checkTimer(new QTimer(this))
-    , checkInterval(readSetting(QStringLiteral("Settings/check_interval"), DEFAULT_CHECK_INTERVAL).toInt())
+    , scheduler(readSetting(QStringLiteral("Settings/check_interval"), DEFAULT_CHECK_INTERVAL).toInt())
+    , systemEvents(new SystemEvents(this))
+    , checkGate(systemEvents)
+    , aurCheckInterval(qMax(60, readSetting(QStringLiteral("Settings/aur_check_interval"),
+                                            DEFAULT_AUR_CHECK_INTERVAL).toInt()))
+    , aurClient(new AurClient(QUrl(readSetting(QStringLiteral("Settings/aur_rpc_url"), DEFAULT_AUR_RPC_URL).toString()),
+                              this))
+    , develCheckEnabled(readBoolSetting(QStringLiteral("Settings/devel_check_enabled"), false))
+    , develCheckParallel(qMax(1, readSetting(QStringLiteral("Settings/devel_check_parallel"), 8).toInt()))
+    , develAllowedSchemes(readSetting(QStringLiteral("Settings/devel_allowed_protocols"), DEFAULT_DEVEL_ALLOWED_PROTOCOLS)
+                              .toString()
+                              .split(u':', Qt::SkipEmptyParts))
     , pendingUpgradeCount(0)
-    , refreshRetryScheduled(false)
+    , privateSyncDb(readBoolSetting(QStringLiteral("Settings/private_sync_db"), true))
+    , prefetchEnabled(readBoolSetting(QStringLiteral("Settings/prefetch_enabled"), false))
+    , prefetchRateLimit(readSetting(QStringLiteral("Settings/prefetch_rate_limit"), 0).toInt())
+    , prefetchPublishTimer(new QTimer(this))
+    , lockWatcher(new QFileSystemWatcher(this))
+    , lockDeadlineTimer(new QTimer(this))
+    , lockWaitTimeout(qMax(60, readSetting(QStringLiteral("Settings/lock_wait_timeout"), DEFAULT_LOCK_WAIT_TIMEOUT).toInt()))
+    , idleTimeout(idleTimeout)
+    , idleTimer(new QTimer(this))
 {
-    // Ensure state file exists on startup
-    {
-        QMutexLocker locker(&stateMutex);
-        QJsonObject state = readState();
-        // If state file doesn't exist or is invalid, write a default one
-        // This ensures we have a valid state file for the tray app to update
-        if (state[QStringLiteral("checked_at")].toVariant().toLongLong() == 0) {
-            writeState(state);
+    // The state file is only read here; afterwards it is persistence for the
+    // in-memory snapshot that serves every read
+    QJsonObject state = readState(STATE_FILE_PATH, requireChecksum);
+    snapshot = makeSnapshot(state, static_cast<quint64>(state[QStringLiteral("generation")].toInteger()) + 1);
+    // If state file doesn't exist or is invalid, write a default one
+    // This ensures we have a valid state file for the tray app to update
+    if (state[QStringLiteral("checked_at")].toVariant().toLongLong() == 0) {
+        writeState(state);
+    }
+    // The interval pushed by the tray and the next due time outlive a restart
+    // in the state
+    const qint64 lastCheck = state[QStringLiteral("checked_at")].toVariant().toLongLong();
+    if (state[QStringLiteral("check_interval")].toInt() > 0) {
+        scheduler.setBaseInterval(state[QStringLiteral("check_interval")].toInt(), lastCheck);
+    }
+    scheduler.restore(state[QStringLiteral("schedule")].toObject(), lastCheck);
+
+    QJsonObject conf = parsePacmanConf();
+    systemDbPath = conf[QStringLiteral("db_path")].toString();
+    cacheDir = conf[QStringLiteral("cache_dir")].toString();
+    if (privateSyncDb && !preparePrivateDb()) {
+        qWarning() << "Private sync database unavailable, checking against the system databases";
+        privateSyncDb = false;
+    }
+
+#ifdef HAVE_LIBALPM
+    if (useAlpm) {
+        alpm = std::make_shared<AlpmBackend>(conf[QStringLiteral("root_dir")].toString(),
+                                             privateSyncDb ? PRIVATE_DB_PATH : systemDbPath,
+                                             conf[QStringLiteral("repos")].toVariant().toStringList(),
+                                             conf[QStringLiteral("ignore_pkg")].toVariant().toStringList(),
+                                             conf[QStringLiteral("ignore_group")].toVariant().toStringList());
+        if (!alpm->open()) {
+            qWarning() << "libalpm unavailable, falling back to pacman processes for package queries";
+            alpm.reset();
         }
     }
-    
+#else
+    Q_UNUSED(useAlpm)
+#endif
+    // Left from an earlier run; the next repo query rebuilds it if stale
+    syncIndex.open(SYNC_INDEX_PATH);
+    localDb = new LocalDbTracker(QDir(systemDbPath).filePath(QStringLiteral("local")), this);
+    loadAurCache();
+    loadDevelCache();
+
+    lockDeadlineTimer->setSingleShot(true);
+    connect(lockWatcher, &QFileSystemWatcher::directoryChanged, this, &SystemMonitor::onDbDirChanged);
+    connect(lockDeadlineTimer, &QTimer::timeout, this, &SystemMonitor::onLockWaitExpired);
+    checkTimer->setSingleShot(true);
     connect(checkTimer, &QTimer::timeout, this, qOverload<>(&SystemMonitor::refresh));
-    checkTimer->start(checkInterval * 1000);
+    connect(systemEvents, &SystemEvents::resumed, this, &SystemMonitor::onResumed);
+    connect(systemEvents, &SystemEvents::networkOnline, this, &SystemMonitor::onNetworkOnline);
+
+    // Warm start: the restored snapshot answers reads right away; a check only
+    // runs now if it is due
+    scheduleNextCheck();
+
+    prefetchPublishTimer->setSingleShot(true);
+    prefetchPublishTimer->setInterval(PREFETCH_PUBLISH_DELAY_MS);
+    connect(prefetchPublishTimer, &QTimer::timeout, this, &SystemMonitor::publishPrefetchStatus);
+
+    idleTimer->setSingleShot(true);
+    connect(idleTimer, &QTimer::timeout, this, &SystemMonitor::onIdleTimeout);
+    noteActivity();
 }
 
-QString SystemMonitor::GetState() {
-    // Return cached JSON if still valid
-    qint64 currentTime = QDateTime::currentSecsSinceEpoch();
-    if (!cachedStateJson.isEmpty() && (currentTime - lastStateChange) < 5) { // Cache for 5 seconds
-        return cachedStateJson;
+void SystemMonitor::scheduleNextCheck() {
+    checkTimer->start(std::chrono::seconds(scheduler.secondsUntilDue(QDateTime::currentSecsSinceEpoch())));
+}
+
+void SystemMonitor::onResumed() {
+    // Timers do not advance while suspended; the due time is wall clock
+    if (scheduler.isDue(QDateTime::currentSecsSinceEpoch())) {
+        checkTimer->start(EVENT_CHECK_DELAY_MS);
+    } else {
+        scheduleNextCheck();
     }
+}
 
-    // Read fresh state from file and cache it
-    QJsonObject state = readState();
-    QJsonDocument doc(state);
-    cachedStateJson = QString::fromUtf8(doc.toJson(QJsonDocument::Compact));
-    lastStateChange = currentTime;
+void SystemMonitor::onNetworkOnline() {
+    if (waitingForNetwork || scheduler.isDue(QDateTime::currentSecsSinceEpoch())) {
+        waitingForNetwork = false;
+        checkTimer->start(EVENT_CHECK_DELAY_MS);
+    }
+}
 
-    return cachedStateJson;
+void SystemMonitor::deferCheck(const QString& reason) {
+    qWarning() << "Deferring scheduled check:" << reason;
+    scheduler.recordDeferral(QDateTime::currentSecsSinceEpoch());
+    QJsonObject state = currentSnapshot()->state;
+    state[QStringLiteral("deferred_reason")] = reason;
+    state[QStringLiteral("schedule")] = scheduler.toJson();
+    publishState(state);
+    scheduleNextCheck();
 }
 
-QString SystemMonitor::GetStateSummary() {
-    // Return cached summary if still valid
-    qint64 currentTime = QDateTime::currentSecsSinceEpoch();
-    if (!cachedSummaryJson.isEmpty() && (currentTime - lastSummaryChange) < 5) {
-        return cachedSummaryJson;
+void SystemMonitor::noteActivity() {
+    if (idleTimeout > 0) {
+        idleTimer->start(idleTimeout * 1000);
+    }
+}
+
+bool SystemMonitor::isBusy() const {
+    return (currentJob && currentJob->isActive()) || (prefetchJob && prefetchJob->isActive()) ||
+           (develJob && develJob->isActive()) || pendingSrcInfo > 0 || lockWaiter;
+}
+
+void SystemMonitor::onIdleTimeout() {
+    // Stay for a check that is due before the next idle period would end
+    if (isBusy() || checkTimer->remainingTimeAsDuration() <= std::chrono::seconds(idleTimeout)) {
+        noteActivity();
+        return;
     }
+    // Everything a restart needs is in the state file
+    qWarning() << "Idle for" << idleTimeout << "seconds, exiting";
+    QCoreApplication::quit();
+}
+
+std::shared_ptr<const StateSnapshot> SystemMonitor::makeSnapshot(const QJsonObject& state, quint64 generation) {
+    auto next = std::make_shared<StateSnapshot>();
+    next->state = state;
+    next->state[QStringLiteral("generation")] = static_cast<qint64>(generation);
+    next->generation = generation;
+    next->stateJson = QString::fromUtf8(QJsonDocument(next->state).toJson(QJsonDocument::Compact));
+
+    // Hash only what clients care about, so a check that finds nothing new
+    // does not count as a change
+    QJsonObject content = state;
+    content.remove(QStringLiteral("generation"));
+    content.remove(QStringLiteral("checked_at"));
+    content.remove(QStringLiteral("aur_checked_at"));
+    content.remove(QStringLiteral("cache_hit"));
+    content.remove(QStringLiteral("schedule"));
+    next->contentHash = stateChecksum(content);
 
-    QJsonObject state = readState();
     QJsonObject summary;
     summary[QStringLiteral("counts")] = state[QStringLiteral("counts")];
     summary[QStringLiteral("status")] = state[QStringLiteral("status")];
     summary[QStringLiteral("checked_at")] = state[QStringLiteral("checked_at")];
+    summary[QStringLiteral("partial")] = state[QStringLiteral("partial")];
+    next->summaryJson = QString::fromUtf8(QJsonDocument(summary).toJson(QJsonDocument::Compact));
+
+    const QJsonObject counts = state[QStringLiteral("counts")].toObject();
+    next->summary.upgrade = counts[QStringLiteral("upgrade")].toInt();
+    next->summary.aurUpgrade = counts[QStringLiteral("aur_upgrade")].toInt();
+    next->summary.totalUpgrade = counts[QStringLiteral("total_upgrade")].toInt();
+    next->summary.remove = counts[QStringLiteral("remove")].toInt();
+    next->summary.held = counts[QStringLiteral("held")].toInt();
+    next->summary.devel = counts[QStringLiteral("devel")].toInt();
+    next->summary.checkedAt = state[QStringLiteral("checked_at")].toInteger();
+    for (const QString& key : {QStringLiteral("packages"), QStringLiteral("aur_packages")}) {
+        for (const PackageUpdate& update : packageUpdatesFromJson(state[key].toArray())) {
+            const QString repository = update.repository.isEmpty() && key == QStringLiteral("aur_packages")
+                                           ? QStringLiteral("aur")
+                                           : update.repository;
+            next->rows.append(PackageRow{update.name, update.oldVersion, update.newVersion, repository});
+        }
+    }
+    return next;
+}
+
+std::shared_ptr<const StateSnapshot> SystemMonitor::currentSnapshot() const {
+    return snapshot;
+}
 
-    QJsonDocument doc(summary);
-    cachedSummaryJson = QString::fromUtf8(doc.toJson(QJsonDocument::Compact));
-    lastSummaryChange = currentTime;
+std::shared_ptr<const StateSnapshot> SystemMonitor::commitState(const QJsonObject& state) {
+    std::shared_ptr<const StateSnapshot> next = makeSnapshot(state, snapshot->generation + 1);
+    history.append(snapshot);
+    while (history.size() > MAX_STATE_HISTORY) {
+        history.removeFirst();
+    }
+    snapshot = next;
+    writeState(next->state);
+    return next;
+}
 
-    return cachedSummaryJson;
+QString SystemMonitor::GetState() {
+    noteActivity();
+    return currentSnapshot()->stateJson;
+}
+
+QString SystemMonitor::GetStateSince(qulonglong generation) {
+    noteActivity();
+    const std::shared_ptr<const StateSnapshot> current = snapshot;
+    std::shared_ptr<const StateSnapshot> base;
+    for (const auto& old : history) {
+        if (old->generation == generation) {
+            base = old;
+            break;
+        }
+    }
+
+    QJsonObject delta;
+    delta[QStringLiteral("generation")] = static_cast<qint64>(current->generation);
+    if (generation == current->generation) {
+        delta[QStringLiteral("full")] = false;
+    } else if (!base) {
+        // Too old (or unknown after a restart): the client has to start over
+        delta[QStringLiteral("full")] = true;
+        delta[QStringLiteral("state")] = current->state;
+        return QString::fromUtf8(QJsonDocument(delta).toJson(QJsonDocument::Compact));
+    } else {
+        delta[QStringLiteral("full")] = false;
+        for (const QString& key : {QStringLiteral("packages"), QStringLiteral("aur_packages")}) {
+            delta[key] = diffPackages(base->state[key].toArray(), current->state[key].toArray());
+        }
+    }
+    for (const QString& key : {QStringLiteral("counts"), QStringLiteral("status"),
+                               QStringLiteral("checked_at"), QStringLiteral("partial"),
+                               QStringLiteral("remove_packages"), QStringLiteral("devel_packages")}) {
+        delta[key] = current->state[key];
+    }
+    return QString::fromUtf8(QJsonDocument(delta).toJson(QJsonDocument::Compact));
+}
+
+QJsonObject SystemMonitor::diffPackages(const QJsonArray& before, const QJsonArray& after) {
+    QHash<QString, QJsonValue> previous;
+    previous.reserve(before.size());
+    for (const QJsonValue& value : before) {
+        previous.insert(packageEntryName(value), value);
+    }
+
+    QJsonArray added;
+    QJsonArray changed;
+    for (const QJsonValue& value : after) {
+        auto it = previous.find(packageEntryName(value));
+        if (it == previous.end()) {
+            added.append(value);
+            continue;
+        }
+        if (it.value() != value) {
+            changed.append(value);
+        }
+        previous.erase(it);
+    }
+
+    QJsonArray removed;
+    for (auto it = previous.cbegin(); it != previous.cend(); ++it) {
+        removed.append(it.key());
+    }
+
+    QJsonObject diff;
+    diff[QStringLiteral("added")] = added;
+    diff[QStringLiteral("changed")] = changed;
+    diff[QStringLiteral("removed")] = removed;
+    return diff;
+}
+
+QString SystemMonitor::GetStateSummary() {
+    noteActivity();
+    return currentSnapshot()->summaryJson;
+}
+
+UpdateSummary SystemMonitor::GetSummary() {
+    noteActivity();
+    return currentSnapshot()->summary;
+}
+
+QList<PackageRow> SystemMonitor::GetPackages(uint offset, uint limit) {
+    noteActivity();
+    std::shared_ptr<const StateSnapshot> current = currentSnapshot();
+    if (offset >= static_cast<uint>(current->rows.size())) {
+        return QList<PackageRow>();
+    }
+    return current->rows.mid(offset, limit == 0 ? -1 : static_cast<qsizetype>(limit));
+}
+
+QString SystemMonitor::GetPackageInfo(const QString& name) {
+    noteActivity();
+    const std::optional<SyncPackage> package = syncIndex.find(name);
+    if (!package) {
+        return QStringLiteral("{}");
+    }
+    return QString::fromUtf8(QJsonDocument(package->toJson()).toJson(QJsonDocument::Compact));
 }
 
 void SystemMonitor::Refresh() {
-    refresh(true);
+    noteActivity();
+    refresh(true, systemEvents->isOnline());
+}
+
+void SystemMonitor::CancelRefresh() {
+    noteActivity();
+    if (currentJob && currentJob->isActive()) {
+        currentJob->cancel();
+    }
+}
+
+QString SystemMonitor::GetRefreshStatus() {
+    noteActivity();
+    QJsonObject status;
+    if (currentJob) {
+        status = currentJob->toJson();
+    } else {
+        status[QStringLiteral("job_id")] = 0;
+        status[QStringLiteral("status")] = QStringLiteral("idle");
+    }
+    return QString::fromUtf8(QJsonDocument(status).toJson(QJsonDocument::Compact));
 }
 
 void SystemMonitor::DelayRefresh(int seconds) {
+    noteActivity();
     int delaySeconds = qMax(5, seconds);
     checkTimer->start(delaySeconds * 1000);
-    refreshDelayed = true;
 }
 
 void SystemMonitor::SetCheckInterval(int seconds) {
-    checkInterval = qMax(60, seconds);
-    checkTimer->start(checkInterval * 1000);
-    refreshDelayed = false;
+    noteActivity();
+    QJsonObject state = currentSnapshot()->state;
+    scheduler.setBaseInterval(seconds, state[QStringLiteral("checked_at")].toVariant().toLongLong());
+    scheduleNextCheck();
+
+    if (state[QStringLiteral("check_interval")].toInt() != scheduler.baseInterval()) {
+        state[QStringLiteral("check_interval")] = scheduler.baseInterval();
+        state[QStringLiteral("schedule")] = scheduler.toJson();
+        commitState(state);
+    }
 }
 
 void SystemMonitor::SetRefreshPaused(bool paused) {
+    noteActivity();
     refreshPaused = paused;
 }
 
 void SystemMonitor::UpdateAurSetting(const QString& key, const QString& value) {
-    // Read current state, update it, and write back
-    QMutexLocker locker(&stateMutex);
-
-    QJsonObject state = readState();
+    noteActivity();
+    // Update the current state and publish it as a new snapshot
+    QJsonObject state = currentSnapshot()->state;
 
     if (key == QStringLiteral("Settings/aur_enabled")) {
         state[QStringLiteral("aur_enabled")] = (value == QStringLiteral("true"));
@@ -115,283 +430,1002 @@ void SystemMonitor::UpdateAurSetting(const QString& key, const QString& value) {
         }
     }
 
-    // Write the updated state to file
-    writeState(state);
-
-    // Invalidate cache since state changed
-    cachedStateJson.clear();
-    lastStateChange = 0;
-    cachedSummaryJson.clear();
-    lastSummaryChange = 0;
+    commitState(state);
 }
 
 void SystemMonitor::refresh() {
-    refresh(true);
+    // Only scheduled checks are gated; an explicit Refresh() always runs.
+    // Offline, the network-online event restarts the check.
+    const bool online = systemEvents->isOnline();
+    if (!online) {
+        waitingForNetwork = true;
+        deferCheck(QStringLiteral("offline"));
+        return;
+    }
+    const QString reason = checkGate.deferReason();
+    if (!reason.isEmpty()) {
+        if (!scheduler.isDeferralExhausted(QDateTime::currentSecsSinceEpoch())) {
+            deferCheck(reason);
+            return;
+        }
+        qWarning() << "Check held back for a whole interval, running despite:" << reason;
+    }
+    refresh(true, online);
 }
 
-void SystemMonitor::refresh(bool syncDb) {
+void SystemMonitor::refresh(bool syncDb, bool online) {
     if (refreshPaused && !syncDb) {
         return;
     }
-    if (isPacmanLocked()) {
-        if (refreshRetryScheduled.testAndSetRelease(false, true)) {
-            QTimer::singleShot(5000, this, [this]() {
-                refreshRetryScheduled.storeRelease(false);
-                refresh();
-            });
-        }
+    if (currentJob && currentJob->isActive()) {
+        // The running job already produces a fresh state; don't stack another
         return;
     }
-    refreshRetryScheduled.storeRelease(false);
-    if (syncDb) {
-        syncPacmanDb();
+    if (currentJob) {
+        currentJob->deleteLater();
     }
+    // The new check may change the pending set; prefetch again after it
+    cancelPrefetch();
+    currentJob = new RefreshJob(++lastJobId, syncDb, this);
+    currentJob->baseUpdatesKey = pendingUpdatesKey(currentSnapshot()->state);
+    currentJob->offline = !online;
+    waitingForNetwork = false;
+    connect(currentJob, &RefreshJob::statusChanged, this, &SystemMonitor::onJobStatusChanged);
+    startJob(currentJob);
+}
 
-    QStringList repoLines = runPacmanQuery();
-    QStringList aurLines;
-
-    // Read AUR settings from state file (protected by mutex) - read once and cache
-    bool aurEnabled;
-    QJsonValue aurEnabledValue;
-    QJsonValue aurHelperValue;
-    {
-        QMutexLocker locker(&stateMutex);
-        QJsonObject currentState = readState();
-        aurEnabledValue = currentState[QStringLiteral("aur_enabled")];
-        aurHelperValue = currentState[QStringLiteral("aur_helper")];
-        aurEnabled = aurEnabledValue.toBool(false);
+void SystemMonitor::startJob(RefreshJob* job) {
+    if (isPacmanLocked()) {
+        retryAfterLock(job);
+        return;
+    }
+    // The AUR query does not depend on the sync DBs, so it runs alongside the
+    // sync and repo query instead of after them
+    if (!job->aurStarted) {
+        startAurQuery(job);
     }
+    if (job->syncDb()) {
+        startSync(job);
+    } else {
+        startRepoQuery(job);
+    }
+}
 
-    QString aurHelper = aurHelperValue.toString();
-    if (aurEnabled) {
-        aurLines = runAurQuery(aurHelper);
-        // If helper was auto-detected, save it back to state
-        if (aurHelper != aurHelperValue.toString()) {
-            QMutexLocker locker(&stateMutex);
-            QJsonObject currentState = readState();
-            currentState[QStringLiteral("aur_helper")] = aurHelper;
-            writeState(currentState);
-            cachedStateJson.clear();
-            lastStateChange = 0;
-            cachedSummaryJson.clear();
-            lastSummaryChange = 0;
-        }
+void SystemMonitor::retryAfterLock(RefreshJob* job) {
+    job->setStatus(RefreshJob::Status::WaitingForLock);
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (job->lockDeadline == 0) {
+        job->lockDeadline = now + qint64(lockWaitTimeout) * 1000;
     }
 
-    QJsonObject newState = buildState(repoLines, aurLines, aurEnabled, aurHelper);
+    // db.lck lives directly in DBPath, so removing it changes the directory
+    lockWaiter = job;
+    if (!lockWatcher->directories().contains(systemDbPath) && !lockWatcher->addPath(systemDbPath)) {
+        qWarning() << "Cannot watch" << systemDbPath << "for the pacman lock";
+    }
+    lockDeadlineTimer->start(static_cast<int>(qMax<qint64>(0, job->lockDeadline - now)));
 
-    //  Write the new state (AUR settings already included from buildState)
-    {
-        QMutexLocker locker(&stateMutex);
-        writeState(newState);
+    if (!isPacmanLocked()) {
+        // Released before the watch was in place, or pacman reported a lock
+        // that is not db.lck; try again shortly rather than spinning
+        QTimer::singleShot(1000, this, &SystemMonitor::onDbDirChanged);
+    }
+}
 
-        // Invalidate cache since state changed
-        cachedStateJson.clear();
-        lastStateChange = 0;
-        cachedSummaryJson.clear();
-        lastSummaryChange = 0;
+void SystemMonitor::stopLockWait() {
+    lockWaiter = nullptr;
+    lockDeadlineTimer->stop();
+    if (lockWatcher->directories().contains(systemDbPath)) {
+        lockWatcher->removePath(systemDbPath);
     }
+}
 
-    QJsonDocument doc(newState);
-    emit stateChanged(QString::fromUtf8(doc.toJson(QJsonDocument::Compact)));
+void SystemMonitor::onDbDirChanged() {
+    RefreshJob* job = lockWaiter;
+    if (!job || !job->isActive()) {
+        stopLockWait();
+        return;
+    }
+    if (job->status() != RefreshJob::Status::WaitingForLock || isPacmanLocked()) {
+        return;
+    }
+    stopLockWait();
+    startJob(job);
+}
 
-    QJsonObject summary;
-    summary[QStringLiteral("counts")] = newState[QStringLiteral("counts")];
-    summary[QStringLiteral("status")] = newState[QStringLiteral("status")];
-    summary[QStringLiteral("checked_at")] = newState[QStringLiteral("checked_at")];
-    QJsonDocument summaryDoc(summary);
-    cachedSummaryJson = QString::fromUtf8(summaryDoc.toJson(QJsonDocument::Compact));
-    lastSummaryChange = QDateTime::currentSecsSinceEpoch();
-    emit summaryChanged(cachedSummaryJson);
+void SystemMonitor::onLockWaitExpired() {
+    RefreshJob* job = lockWaiter;
+    stopLockWait();
+    if (!job || !job->isActive()) {
+        return;
+    }
+    const QString message = QStringLiteral("Gave up waiting for the pacman database lock after %1 seconds")
+                                .arg(lockWaitTimeout);
+    qWarning() << message;
+
+    // Keep the last known packages; only the status says this check failed
+    QJsonObject state = currentSnapshot()->state;
+    state[QStringLiteral("status")] = QStringLiteral("error");
+    state[QStringLiteral("errors")] = QJsonArray{message};
+    state[QStringLiteral("partial")] = false;
+    scheduler.recordFailure(QDateTime::currentSecsSinceEpoch());
+    state[QStringLiteral("schedule")] = scheduler.toJson();
+    publishState(state);
+
+    job->fail();
+}
 
-    if (refreshDelayed) {
-        checkTimer->start(checkInterval * 1000);
-        refreshDelayed = false;
+void SystemMonitor::onJobStatusChanged() {
+    auto* job = qobject_cast<RefreshJob*>(sender());
+    if (!job) {
+        return;
     }
+    if (!job->isActive()) {
+        if (lockWaiter == job) {
+            // Cancelled or failed while waiting for db.lck; nothing waits any more
+            stopLockWait();
+        }
+        if (job->status() == RefreshJob::Status::Cancelled) {
+            scheduler.recordFailure(QDateTime::currentSecsSinceEpoch());
+        }
+        if (job->status() != RefreshJob::Status::Finished) {
+            // Local DB changes taken by this job never made it into a result
+            resultSyncFingerprint.clear();
+            // A first-phase result would otherwise stay published as partial
+            // with nothing left to complete it. Its repo part is valid; the
+            // AUR part goes back to what was published before this job.
+            if (!job->stateBeforePartial.isEmpty() &&
+                currentSnapshot()->state[QStringLiteral("partial")].toBool()) {
+                QJsonObject state = currentSnapshot()->state;
+                const QJsonObject& before = job->stateBeforePartial;
+                state[QStringLiteral("partial")] = false;
+                state[QStringLiteral("aur_packages")] = before[QStringLiteral("aur_packages")];
+                state[QStringLiteral("aur_checked_at")] = before[QStringLiteral("aur_checked_at")];
+                QJsonObject counts = state[QStringLiteral("counts")].toObject();
+                const int aurCount = before[QStringLiteral("aur_packages")].toArray().size();
+                counts[QStringLiteral("aur_upgrade")] = aurCount;
+                counts[QStringLiteral("total_upgrade")] = counts[QStringLiteral("upgrade")].toInt() + aurCount;
+                state[QStringLiteral("counts")] = counts;
+                state[QStringLiteral("schedule")] = scheduler.toJson();
+                publishState(state);
+            }
+        }
+        scheduleNextCheck();
+        noteActivity(); // Count idle time from the end of the check
+    }
+    QJsonDocument doc(job->toJson());
+    emit refreshStatusChanged(QString::fromUtf8(doc.toJson(QJsonDocument::Compact)));
 }
 
 bool SystemMonitor::isPacmanLocked() const {
-    return QFile::exists(QStringLiteral("/var/lib/pacman/db.lck"));
+    return QFile::exists(QDir(systemDbPath).filePath(QStringLiteral("db.lck")));
+}
+
+bool SystemMonitor::isLockError(const ProcessResult& result) {
+    return result.errorOutput.contains(QStringLiteral("could not lock database")) ||
+           result.errorOutput.contains(QStringLiteral("unable to lock database"));
+}
+
+QString SystemMonitor::activeDbPath() const {
+    return privateSyncDb ? PRIVATE_DB_PATH : systemDbPath;
 }
 
-bool SystemMonitor::syncPacmanDb() {
-    qWarning() << "Starting pacman DB sync: pacman -Sy";
-    for (int attempt = 0; attempt < 2; ++attempt) {
-        QProcess process;
-        process.start(QStringLiteral("pacman"), QStringList() << QStringLiteral("-Sy"));
+QStringList SystemMonitor::pacmanDbArgs() const {
+    if (!privateSyncDb) {
+        return QStringList();
+    }
+    return QStringList() << QStringLiteral("--dbpath") << PRIVATE_DB_PATH;
+}
+
+bool SystemMonitor::preparePrivateDb() {
+    // Same layout as checkupdates: a private DBPath whose "local" links to the
+    // system local DB (read-only use) and whose "sync" is ours to update. pacman
+    // then takes the lock inside the private DBPath, never the system db.lck.
+    QDir privateDir(PRIVATE_DB_PATH);
+    if (!privateDir.mkpath(QStringLiteral("sync"))) {
+        qWarning() << "Failed to create private sync database directory:" << privateDir.absolutePath();
+        return false;
+    }
 
-        if (!process.waitForStarted(5000)) {
-            qWarning() << "Failed to start pacman -Sy:" << process.errorString();
+    const QString localLink = privateDir.filePath(QStringLiteral("local"));
+    const QString systemLocal = QDir(systemDbPath).filePath(QStringLiteral("local"));
+    QFileInfo localInfo(localLink);
+    if (!localInfo.isSymLink() || localInfo.symLinkTarget() != QFileInfo(systemLocal).absoluteFilePath()) {
+        QFile::remove(localLink);
+        if (!QFile::link(systemLocal, localLink)) {
+            qWarning() << "Failed to link system local database into" << localLink;
             return false;
         }
+    }
 
-        if (!process.waitForFinished(60000)) { // 60 second timeout
-            if (process.error() == QProcess::Timedout) {
-                qWarning() << "pacman -Sy timed out after 60 seconds";
-            } else {
-                qWarning() << "pacman -Sy process error:" << process.errorString();
+    // Seed from the system sync DBs when they are newer so the first private
+    // sync does not download every database again
+    QDir systemSync(QDir(systemDbPath).filePath(QStringLiteral("sync")));
+    QDir privateSync(privateDir.filePath(QStringLiteral("sync")));
+    const QFileInfoList systemDbs = systemSync.entryInfoList(QStringList() << QStringLiteral("*.db"), QDir::Files);
+    for (const QFileInfo& systemDb : systemDbs) {
+        const QString target = privateSync.filePath(systemDb.fileName());
+        QFileInfo targetInfo(target);
+        if (targetInfo.exists() && targetInfo.lastModified() >= systemDb.lastModified()) {
+            continue;
+        }
+        QFile::remove(target);
+        if (QFile::copy(systemDb.absoluteFilePath(), target)) {
+            // pacman uses the file mtime for If-Modified-Since downloads
+            QFile copied(target);
+            if (copied.open(QIODevice::ReadWrite)) {
+                copied.setFileTime(systemDb.lastModified(), QFileDevice::FileModificationTime);
             }
-            process.kill();
-            return false;
         }
+    }
 
-        if (process.exitCode() != 0) {
-            QString errorOutput = QString::fromUtf8(process.readAllStandardError());
-            if (errorOutput.contains(QStringLiteral("could not lock database")) ||
-                errorOutput.contains(QStringLiteral("unable to lock database"))) {
-                if (refreshRetryScheduled.testAndSetRelease(false, true)) {
-                    QTimer::singleShot(5000, this, [this]() {
-                        refreshRetryScheduled.storeRelease(false);
-                        refresh();
-                    });
-                }
-                return false;
+    // Only this daemon uses the private DBPath and it never syncs twice at
+    // once, so any lock left behind is stale (e.g. from a killed pacman)
+    QFile::remove(privateDir.filePath(QStringLiteral("db.lck")));
+    return true;
+}
+
+void SystemMonitor::startSync(RefreshJob* job) {
+    if (job->offline) {
+        // A sync could only run into its timeout; answer from the local DBs
+        qWarning() << "Offline, skipping pacman DB sync";
+        startRepoQuery(job);
+        return;
+    }
+    if (privateSyncDb && !preparePrivateDb()) {
+        qWarning() << "Skipping pacman DB sync: private sync database unavailable";
+        startRepoQuery(job);
+        return;
+    }
+    const QStringList args = QStringList() << QStringLiteral("-Sy") << pacmanDbArgs()
+                                           << QStringLiteral("--logfile") << QStringLiteral("/dev/null");
+    qWarning() << "Starting pacman DB sync: pacman" << args;
+    job->setStatus(RefreshJob::Status::Syncing);
+    job->run(QStringLiteral("pacman"), args, 60000, [this, job](const ProcessResult& result) {
+        if (result.timedOut) {
+            qWarning() << "pacman -Sy timed out after 60 seconds";
+        } else if (!result.ok) {
+            qWarning() << "pacman -Sy process error:" << result.errorString;
+        } else if (result.exitCode != 0) {
+            if (isLockError(result)) {
+                retryAfterLock(job);
+                return;
             }
-            qWarning() << "pacman -Sy exited with code:" << process.exitCode();
-            return false;
+            qWarning() << "pacman -Sy exited with code:" << result.exitCode;
+        } else {
+            qWarning() << "pacman -Sy completed successfully";
+        }
+        startRepoQuery(job);
+    });
+}
+
+void SystemMonitor::startRepoQuery(RefreshJob* job) {
+    job->setStatus(RefreshJob::Status::Querying);
+
+    // Reuse the previous result when no database (or pacman.conf) changed
+    // since it was computed
+    job->dbFingerprint = pacmanDbFingerprint(activeDbPath(), QStringList() << QStringLiteral("/etc/pacman.conf"));
+    job->syncFingerprint = syncDbFingerprint(activeDbPath(),
+                                             parsePacmanConf()[QStringLiteral("repos")].toVariant().toStringList());
+    QSet<QString> touched;
+    const bool touchedKnown = localDb->takeChanges(touched);
+    std::shared_ptr<const StateSnapshot> current = currentSnapshot();
+    const QJsonObject& previous = current->state;
+    if (previous[QStringLiteral("status")].toString() == QStringLiteral("ok") &&
+        previous[QStringLiteral("db_fingerprint")].toString() == job->dbFingerprint) {
+        job->repoUpdates = packageUpdatesFromJson(previous[QStringLiteral("packages")].toArray());
+        job->removals = previous[QStringLiteral("remove_packages")].toArray();
+        job->cacheHit = true;
+    }
+    if (job->cacheHit) {
+        qWarning() << "Package databases unchanged, reusing previous result";
+        onRepoQueryDone(job);
+        return;
+    }
+    // Otherwise only packages changed since the previous result are looked
+    // at: local transactions from the tracker, upstream changes from a diff
+    // of the old and new sync index
+    if (touchedKnown && canUpdateIncrementally()) {
+        if (syncIndex.fingerprint() == job->syncFingerprint) {
+            updatePendingIncrementally(job, touched);
+            scanRemovals(job);
+        } else {
+            updateSyncIndex(job, touched);
         }
+        return;
+    }
+    startFullRepoQuery(job);
+}
 
-        qWarning() << "pacman -Sy completed successfully";
-        return true;
+void SystemMonitor::startFullRepoQuery(RefreshJob* job) {
+#ifdef HAVE_LIBALPM
+    // Reloading the handle and comparing every package takes a while on large
+    // systems, so it runs off the event loop like the sync DB scan. The handle
+    // is only ever used by one worker; a job that starts while a cancelled
+    // one's worker is still running asks pacman instead.
+    if (alpm && !(alpmWorker && alpmWorker->isRunning())) {
+        std::shared_ptr<AlpmBackend> backend = alpm;
+        auto updates = std::make_shared<QList<PackageUpdate>>();
+        auto loaded = std::make_shared<bool>(false);
+        QThread* worker = QThread::create([backend, updates, loaded]() {
+            if (backend->reload()) {
+                *updates = backend->queryUpdates();
+                *loaded = true;
+            }
+        });
+        alpmWorker = worker;
+        connect(worker, &QThread::finished, worker, &QObject::deleteLater);
+        connect(worker, &QThread::finished, job, [this, job, updates, loaded]() {
+            if (!job->isActive()) {
+                return;
+            }
+            if (!*loaded) {
+                qWarning() << "libalpm reload failed, falling back to pacman -Qu";
+                startPacmanQuery(job);
+                return;
+            }
+            job->repoUpdates = *updates;
+            qWarning() << "libalpm query found" << job->repoUpdates.size() << "updates";
+            // Flags are already set; the scan fills the IgnoreGroup members
+            // the AUR result is checked against
+            scanRemovals(job);
+        });
+        worker->start();
+        return;
     }
-    return false;
+#endif
+    startPacmanQuery(job);
 }
 
-QStringList SystemMonitor::runPacmanQuery() {
+void SystemMonitor::startPacmanQuery(RefreshJob* job) {
     qWarning() << "Starting pacman query: pacman -Qu";
-    for (int attempt = 0; attempt < 2; ++attempt) {
-        QProcess process;
-        process.start(QStringLiteral("pacman"), QStringList() << QStringLiteral("-Qu"));
+    job->run(QStringLiteral("pacman"), QStringList() << QStringLiteral("-Qu") << pacmanDbArgs(), 30000,
+             [this, job](const ProcessResult& result) {
+        if (result.timedOut) {
+            qWarning() << "pacman -Qu timed out after 30 seconds";
+            job->syncFingerprint.clear();
+        } else if (!result.ok) {
+            qWarning() << "pacman process error:" << result.errorString;
+            job->syncFingerprint.clear();
+        } else if (result.exitCode != 0 && result.exitCode != 1) {
+            if (isLockError(result)) {
+                retryAfterLock(job);
+                return;
+            }
+            qWarning() << "pacman -Qu exited with code:" << result.exitCode;
+            job->syncFingerprint.clear();
+        } else {
+            job->repoUpdates = parseUpdateLines(splitOutputLines(result.output), QStringLiteral("repo"));
+            qWarning() << "pacman -Qu parsed" << job->repoUpdates.size() << "lines";
+        }
+        scanRemovals(job);
+    });
+}
+
+bool SystemMonitor::canUpdateIncrementally() {
+    // The previous result was computed against the sync DBs still in the
+    // index, so the packages changed since then (locally or upstream) are
+    // the only ones whose pending state can differ
+    return currentSnapshot()->state[QStringLiteral("status")].toString() == QStringLiteral("ok") &&
+           !resultSyncFingerprint.isEmpty() && resultSyncFingerprint == syncIndex.fingerprint();
+}
 
-        if (!process.waitForStarted(5000)) {
-            qWarning() << "Failed to start pacman process:" << process.errorString();
-            return QStringList();
+void SystemMonitor::updateSyncIndex(RefreshJob* job, const QSet<QString>& touched) {
+    // New sync DBs: decode them into a new index off the event loop, noting
+    // which packages changed version or repository against the previous one
+    const QString dbPath = activeDbPath();
+    const QStringList repos = parsePacmanConf()[QStringLiteral("repos")].toVariant().toStringList();
+    const QString previousFingerprint = syncIndex.fingerprint();
+    const QString syncFingerprint = job->syncFingerprint;
+    auto changed = std::make_shared<QSet<QString>>();
+    auto written = std::make_shared<bool>(false);
+    QThread* worker = QThread::create([dbPath, repos, previousFingerprint, syncFingerprint, changed, written]() {
+        SyncIndex previous;
+        if (!previous.open(SYNC_INDEX_PATH) || previous.fingerprint() != previousFingerprint) {
+            return;
+        }
+        QString error;
+        const QList<SyncPackage> packages = readSyncDbs(dbPath, repos, &error);
+        if (!error.isEmpty()) {
+            // An index without that repository would drop its pending updates
+            return;
+        }
+        *changed = previous.diff(packages);
+        previous.close();
+        *written = SyncIndex::write(SYNC_INDEX_PATH, syncFingerprint, packages);
+    });
+    connect(worker, &QThread::finished, worker, &QObject::deleteLater);
+    connect(worker, &QThread::finished, this, [this, written]() {
+        if (*written) {
+            syncIndex.open(SYNC_INDEX_PATH);
+        }
+    });
+    connect(worker, &QThread::finished, job, [this, job, touched, changed]() {
+        if (!job->isActive()) {
+            return;
         }
+        if (syncIndex.fingerprint() != job->syncFingerprint) {
+            qWarning() << "Sync index update failed, running a full query";
+            startFullRepoQuery(job);
+            return;
+        }
+        qWarning() << "Sync databases changed" << changed->size() << "packages";
+        updatePendingIncrementally(job, touched + *changed);
+        scanRemovals(job);
+    });
+    worker->start();
+}
 
-        if (!process.waitForFinished(30000)) { // 30 second timeout
-            if (process.error() == QProcess::Timedout) {
-                qWarning() << "pacman -Qu timed out after 30 seconds";
-            } else {
-                qWarning() << "pacman process error:" << process.errorString();
+void SystemMonitor::updatePendingIncrementally(RefreshJob* job, const QSet<QString>& touched) {
+    // Only valid when canUpdateIncrementally() and the index matches the job's
+    // sync DBs; every package outside touched keeps its previous result
+    std::shared_ptr<const StateSnapshot> current = currentSnapshot();
+    const QJsonObject& previous = current->state;
+    QMap<QString, PackageUpdate> pending; // Sorted by name, like pacman -Qu
+    for (PackageUpdate update : packageUpdatesFromJson(previous[QStringLiteral("packages")].toArray())) {
+        update.held = false; // Applied again, pacman.conf may have changed
+        pending.insert(update.name, update);
+    }
+    for (const QString& name : touched) {
+        pending.remove(name);
+        const QString localVersion = localDb->version(name);
+        if (localVersion.isEmpty()) {
+            continue;
+        }
+        const std::optional<SyncPackage> sync = syncIndex.find(name);
+        if (sync && vercmp(localVersion, sync->version) < 0) {
+            PackageUpdate update;
+            update.name = name;
+            update.oldVersion = localVersion;
+            update.newVersion = sync->version;
+            update.repository = sync->repository;
+            update.source = QStringLiteral("repo");
+            pending.insert(name, update);
+        }
+    }
+    job->repoUpdates = pending.values();
+    qWarning() << "Re-evaluated" << touched.size() << "changed packages," << job->repoUpdates.size() << "updates";
+}
+
+void SystemMonitor::scanRemovals(RefreshJob* job) {
+    // Reading every sync DB takes a moment on large repo sets, so it runs off
+    // the event loop; like the rest of the repo query it is skipped entirely
+    // while the DB fingerprint is unchanged. The decoded databases are kept in
+    // the sync index, so only a changed sync DB is decompressed again. The
+    // same pass finds the IgnoreGroup members: libalpm flags held updates
+    // itself, the pacman -Qu path and the AUR result are flagged here.
+    const QJsonObject conf = parsePacmanConf();
+    const QString dbPath = activeDbPath();
+    const QStringList repos = conf[QStringLiteral("repos")].toVariant().toStringList();
+    const QStringList patterns = conf[QStringLiteral("ignore_pkg")].toVariant().toStringList();
+    const QStringList ignoreGroups = conf[QStringLiteral("ignore_group")].toVariant().toStringList();
+    const QSet<QString> groups(ignoreGroups.cbegin(), ignoreGroups.cend());
+    const QString syncFingerprint = syncDbFingerprint(dbPath, repos);
+    const bool indexFresh = syncIndex.isOpen() && syncIndex.fingerprint() == syncFingerprint;
+    QSet<QString> targets;
+    for (const PackageUpdate& update : std::as_const(job->repoUpdates)) {
+        targets.insert(update.name);
+    }
+
+    const QHash<QString, QString> installed = localDb->packages();
+
+    auto removals = std::make_shared<QJsonArray>();
+    auto groupMembers = std::make_shared<std::optional<QSet<QString>>>();
+    auto indexRebuilt = std::make_shared<bool>(false);
+    QThread* worker = QThread::create([dbPath, repos, targets, installed, groups, removals, groupMembers,
+                                       syncFingerprint, indexFresh, indexRebuilt]() {
+        QList<SyncPackage> packages;
+        SyncIndex index;
+        if (indexFresh && index.open(SYNC_INDEX_PATH) && index.fingerprint() == syncFingerprint) {
+            packages = index.packages();
+        } else {
+            QString error;
+            packages = readSyncDbs(dbPath, repos, &error);
+            // Not indexed when a database is unreadable; the next check retries
+            *indexRebuilt = error.isEmpty() && SyncIndex::write(SYNC_INDEX_PATH, syncFingerprint, packages);
+            if (!error.isEmpty()) {
+                return;
             }
-            process.kill();
-            return QStringList();
-        }
-
-        int exitCode = process.exitCode();
-        if (exitCode != 0 && exitCode != 1) {
-            QString errorOutput = QString::fromUtf8(process.readAllStandardError());
-            if (errorOutput.contains(QStringLiteral("could not lock database")) ||
-                errorOutput.contains(QStringLiteral("unable to lock database"))) {
-                if (refreshRetryScheduled.testAndSetRelease(false, true)) {
-                    QTimer::singleShot(5000, this, [this]() {
-                        refreshRetryScheduled.storeRelease(false);
-                        refresh();
-                    });
+        }
+        // Like pacman -Sg, members from every repository count
+        QSet<QString> members;
+        for (const SyncPackage& package : std::as_const(packages)) {
+            for (const QString& group : package.groups) {
+                if (groups.contains(group)) {
+                    members.insert(package.name);
+                    break;
                 }
-                return QStringList();
             }
-            qWarning() << "pacman -Qu exited with code:" << exitCode;
-            return QStringList();
-        }
-
-        QString output = QString::fromUtf8(process.readAllStandardOutput());
-        qWarning() << "pacman -Qu output:" << output;
-        QStringList lines;
-        lines.reserve(output.count(QLatin1Char('\n')) + 1);
-        for (QStringView lineView : QStringTokenizer{output, u'\n', Qt::SkipEmptyParts}) {
-            lineView = lineView.trimmed();
-            if (!lineView.isEmpty()) {
-                lines.append(lineView.toString());
+        }
+        *groupMembers = members;
+        for (const PendingRemoval& removal : findPendingRemovals(packages, installed, targets)) {
+            removals->append(removal.toJson());
+        }
+    });
+    connect(worker, &QThread::finished, worker, &QObject::deleteLater);
+    connect(worker, &QThread::finished, this, [this, indexRebuilt, groupMembers]() {
+        if (*indexRebuilt) {
+            syncIndex.open(SYNC_INDEX_PATH);
+            qWarning() << "Sync index rebuilt with" << syncIndex.size() << "packages";
+        }
+        if (groupMembers->has_value()) {
+            heldGroupMembers = **groupMembers;
+        } else {
+            qWarning() << "Sync databases unreadable, keeping the previous IgnoreGroup members";
+        }
+    });
+    connect(worker, &QThread::finished, job, [this, job, removals, patterns]() {
+        if (!job->isActive()) {
+            return;
+        }
+        applyHeld(job->repoUpdates, patterns, heldGroupMembers);
+        job->removals = *removals;
+        onRepoQueryDone(job);
+    });
+    worker->start();
+}
+
+void SystemMonitor::applyHeld(QList<PackageUpdate>& updates, const QStringList& patterns,
+                              const QSet<QString>& groupMembers) {
+    for (PackageUpdate& update : updates) {
+        if (update.held) {
+            continue;
+        }
+        if (groupMembers.contains(update.name)) {
+            update.held = true;
+            continue;
+        }
+        const QByteArray name = update.name.toUtf8();
+        for (const QString& pattern : patterns) {
+            // IgnorePkg entries are shell globs
+            if (::fnmatch(pattern.toUtf8().constData(), name.constData(), 0) == 0) {
+                update.held = true;
+                break;
             }
         }
-        qWarning() << "pacman -Qu parsed" << lines.size() << "lines";
-        return lines;
     }
-    return QStringList();
 }
 
-QStringList SystemMonitor::runAurQuery(QString& aurHelper) {
-    // aurHelper is passed by reference and may be updated if auto-detected
+void SystemMonitor::startAurQuery(RefreshJob* job) {
+    job->aurStarted = true;
+    // AUR settings live in the state so the root monitor can read them. The
+    // copy only decides whether this run queries the AUR; published states
+    // take the settings from the snapshot current at that time.
+    job->aurEnabled = currentSnapshot()->state[QStringLiteral("aur_enabled")].toBool(false);
+    if (!job->aurEnabled) {
+        onAurQueryDone(job);
+        return;
+    }
 
-    if (aurHelper.isEmpty()) {
-        aurHelper = detectAurHelper();
-        if (aurHelper.isEmpty()) {
-            qWarning() << "No AUR helper available for AUR updates";
-            return QStringList(); // No AUR helper available
-        }
-        // Caller will save the detected helper back to state
-    } else {
-        // Validate that the configured helper is still available
-        QProcess checkProcess;
-        checkProcess.start(QStringLiteral("which"), QStringList() << aurHelper);
-        if (!checkProcess.waitForFinished(2000) || checkProcess.exitCode() != 0) {
-            qWarning() << "Configured AUR helper" << aurHelper << "is no longer available, trying to find alternative";
-            QString newHelper = detectAurHelper();
-            if (newHelper.isEmpty()) {
-                qWarning() << "No AUR helper available for AUR updates";
-                return QStringList();
+    // AUR versions are fetched on their own, slower cadence; in between (and
+    // offline) the cached ones are compared against the installed versions,
+    // which catches AUR packages upgraded since the last AUR check
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    const bool cacheFresh = aurCheckedAt > 0 && now - aurCheckedAt < aurCheckInterval;
+    if (job->offline || cacheFresh) {
+        // Newly installed foreign packages are looked up alone when possible
+        QStringList missing;
+        if (!job->offline && syncIndex.isOpen()) {
+            for (const QString& name : foreignPackages()) {
+                if (!aurVersions.contains(name)) {
+                    missing.append(name);
+                }
             }
-            aurHelper = newHelper;
-            // Caller will save the detected helper back to state
         }
+        if (missing.isEmpty()) {
+            keepAurResult(job);
+            onAurQueryDone(job);
+        } else {
+            queryAurRpc(job, missing, false);
+        }
+        return;
+    }
+    // Foreign packages are the installed ones no sync DB has; without the
+    // index to tell them apart the query waits for the repo query to build it
+    if (!syncIndex.isOpen()) {
+        job->aurWaitsForIndex = true;
+        return;
     }
+    queryAurRpc(job, foreignPackages(), true);
+}
 
-    // SECURITY: never execute anything that is not an allowlisted helper name,
-    // and run it from a trusted absolute path rather than a caller-supplied one.
-    // This is the last line of defense if the state file is ever poisoned.
-    if (!isAllowedAurHelper(aurHelper)) {
-        qWarning() << "Refusing to run non-allowlisted AUR helper:" << aurHelper;
-        return QStringList();
+void SystemMonitor::keepAurResult(RefreshJob* job) {
+    // The cached AUR versions against the installed ones, or the last result
+    // while nothing is cached yet
+    if (aurCheckedAt > 0) {
+        job->aurUpdates = aurUpdatesFromCache();
+    } else {
+        job->aurUpdates = packageUpdatesFromJson(currentSnapshot()->state[QStringLiteral("aur_packages")].toArray());
     }
-    const QString aurHelperPath = QStandardPaths::findExecutable(aurHelper);
-    if (aurHelperPath.isEmpty()) {
-        qWarning() << "AUR helper not found on PATH:" << aurHelper;
-        return QStringList();
+}
+
+QStringList SystemMonitor::foreignPackages() const {
+    QStringList foreign;
+    const QHash<QString, QString>& installed = localDb->packages();
+    for (auto it = installed.cbegin(); it != installed.cend(); ++it) {
+        if (syncIndex.version(it.key()).isEmpty()) {
+            foreign.append(it.key());
+        }
     }
+    foreign.sort();
+    return foreign;
+}
 
-    qWarning() << "Starting AUR query with helper:" << aurHelperPath << "command:" << aurHelperPath << "-Qua";
+void SystemMonitor::queryAurRpc(RefreshJob* job, const QStringList& names, bool fullCheck) {
+    qWarning() << "Querying the AUR RPC for" << names.size() << "foreign packages";
+    QPointer<RefreshJob> guard(job);
+    aurClient->queryVersions(names, [this, guard, names, fullCheck](const QHash<QString, QString>& versions,
+                                                                    const QString& error) {
+        if (!guard || !guard->isActive()) {
+            return;
+        }
+        if (!error.isEmpty()) {
+            // The cache stays as it is and the next check queries again
+            qWarning() << "AUR RPC query failed:" << error;
+            guard->aurError = QStringLiteral("AUR query failed: ") + error;
+            keepAurResult(guard);
+            onAurQueryDone(guard);
+            return;
+        }
+        if (fullCheck) {
+            aurVersions.clear();
+            aurCheckedAt = QDateTime::currentSecsSinceEpoch();
+        }
+        // Names the AUR does not know are cached too (empty version), so
+        // they are not asked for again until the next full check
+        for (const QString& name : names) {
+            aurVersions.insert(name, versions.value(name));
+        }
+        saveAurCache();
+        guard->aurUpdates = aurUpdatesFromCache();
+        qWarning() << "AUR RPC query found" << guard->aurUpdates.size() << "updates";
+        onAurQueryDone(guard);
+    });
+}
 
-    QProcess process;
-    process.start(aurHelperPath, QStringList() << QStringLiteral("-Qua"));
+QList<PackageUpdate> SystemMonitor::aurUpdatesFromCache() const {
+    QStringList names = aurVersions.keys();
+    names.sort();
+    QList<PackageUpdate> updates;
+    for (const QString& name : std::as_const(names)) {
+        const QString localVersion = localDb->version(name);
+        const QString aurVersion = aurVersions.value(name);
+        if (!localVersion.isEmpty() && !aurVersion.isEmpty() && vercmp(localVersion, aurVersion) < 0) {
+            PackageUpdate update;
+            update.name = name;
+            update.oldVersion = localVersion;
+            update.newVersion = aurVersion;
+            update.repository = QStringLiteral("aur");
+            update.source = QStringLiteral("aur");
+            updates.append(update);
+        }
+    }
+    // AUR helpers skip IgnorePkg/IgnoreGroup packages too; here they are flagged
+    applyHeld(updates, parsePacmanConf()[QStringLiteral("ignore_pkg")].toVariant().toStringList(), heldGroupMembers);
+    return updates;
+}
 
-    if (!process.waitForStarted(5000)) {
-        qWarning() << "Failed to start AUR helper process:" << process.errorString();
-        return QStringList();
+void SystemMonitor::loadAurCache() {
+    QFile file(AUR_CACHE_PATH);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    const QJsonObject cache = QJsonDocument::fromJson(file.readAll()).object();
+    aurCheckedAt = cache[QStringLiteral("checked_at")].toInteger();
+    const QJsonObject versions = cache[QStringLiteral("versions")].toObject();
+    for (auto it = versions.constBegin(); it != versions.constEnd(); ++it) {
+        aurVersions.insert(it.key(), it.value().toString());
+    }
+}
+
+void SystemMonitor::saveAurCache() {
+    QJsonObject versions;
+    for (auto it = aurVersions.cbegin(); it != aurVersions.cend(); ++it) {
+        versions[it.key()] = it.value();
     }
+    QJsonObject cache;
+    cache[QStringLiteral("checked_at")] = aurCheckedAt;
+    cache[QStringLiteral("versions")] = versions;
+    QSaveFile file(AUR_CACHE_PATH);
+    if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(cache).toJson(QJsonDocument::Compact)) < 0 ||
+        !file.commit()) {
+        qWarning() << "Cannot write AUR cache" << AUR_CACHE_PATH << ":" << file.errorString();
+    }
+}
 
-    if (!process.waitForFinished(60000)) { // 60 second timeout (AUR queries can be slower)
-        if (process.error() == QProcess::Timedout) {
-            qWarning() << aurHelper << "-Qua timed out after 60 seconds";
+void SystemMonitor::onRepoQueryDone(RefreshJob* job) {
+    job->repoDone = true;
+    if (job->aurWaitsForIndex) {
+        job->aurWaitsForIndex = false;
+        if (syncIndex.isOpen()) {
+            queryAurRpc(job, foreignPackages(), true);
         } else {
-            qWarning() << aurHelper << "process error:" << process.errorString();
+            // No index this time either (e.g. a cache hit); check the AUR next time
+            keepAurResult(job);
+            onAurQueryDone(job);
         }
-        process.kill();
-        return QStringList();
+    }
+    if (job->aurDone) {
+        finishJob(job);
+        return;
     }
 
-    int exitCode = process.exitCode();
-    if (exitCode != 0 && exitCode != 1) {
-        qWarning() << aurHelper << "-Qua exited with code:" << exitCode;
-        return QStringList();
+    // First phase: publish the repo result right away. The AUR part keeps its
+    // previous result until the AUR query finishes.
+    job->stateBeforePartial = currentSnapshot()->state;
+    const QList<PackageUpdate> previousAurUpdates =
+        packageUpdatesFromJson(job->stateBeforePartial[QStringLiteral("aur_packages")].toArray());
+    publishState(buildJobState(job, previousAurUpdates, true));
+}
+
+void SystemMonitor::onAurQueryDone(RefreshJob* job) {
+    job->aurDone = true;
+    if (job->repoDone) {
+        finishJob(job);
     }
+}
 
-    QString output = QString::fromUtf8(process.readAllStandardOutput());
-    qWarning() << "AUR query output:" << output;
+void SystemMonitor::finishJob(RefreshJob* job) {
+    QJsonObject newState = buildJobState(job, job->aurUpdates, false);
+    // Checks that keep finding the same updates stretch the interval
+    const bool changed = pendingUpdatesKey(newState) != job->baseUpdatesKey;
+    scheduler.recordCheck(newState[QStringLiteral("checked_at")].toInteger(), changed);
+    newState[QStringLiteral("schedule")] = scheduler.toJson();
+    publishState(newState);
+    resultSyncFingerprint = job->syncFingerprint;
 
-    QStringList lines;
-    lines.reserve(output.count(QLatin1Char('\n')) + 1);
-    for (QStringView lineView : QStringTokenizer{output, u'\n', Qt::SkipEmptyParts}) {
-        lineView = lineView.trimmed();
-        if (!lineView.isEmpty()) {
-            lines.append(lineView.toString());
+    job->setStatus(RefreshJob::Status::Finished);
+
+    if (prefetchEnabled && !job->repoUpdates.isEmpty()) {
+        startPrefetch();
+    }
+    if (job->aurEnabled && !job->offline) {
+        startDevelCheck();
+    }
+}
+
+void SystemMonitor::startDevelCheck() {
+    // Upstream repositories are contacted on the AUR cadence
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    if (!develCheckEnabled || (develJob && develJob->isActive()) || pendingSrcInfo > 0 || !syncIndex.isOpen() ||
+        (develCheckedAt > 0 && now - develCheckedAt < aurCheckInterval)) {
+        return;
+    }
+    static const QStringList vcsSuffixes = {QStringLiteral("-git"), QStringLiteral("-hg"), QStringLiteral("-svn")};
+    QSet<QString> develPackages;
+    for (const QString& name : foreignPackages()) {
+        for (const QString& suffix : vcsSuffixes) {
+            if (name.endsWith(suffix)) {
+                develPackages.insert(name);
+                break;
+            }
         }
     }
-    qWarning() << "AUR query parsed" << lines.size() << "lines";
-    return lines;
+    develCache.removeIf([&develPackages](const QHash<QString, DevelEntry>::iterator it) {
+        return !develPackages.contains(it.key());
+    });
+
+    // Sources come from the AUR once per package; the package name stands in
+    // for the package base, which matches for nearly all VCS packages
+    for (const QString& name : std::as_const(develPackages)) {
+        if (develCache.contains(name)) {
+            continue;
+        }
+        ++pendingSrcInfo;
+        aurClient->fetchSrcInfo(name, [this, name](const QString& srcinfo, const QString& error) {
+            --pendingSrcInfo;
+            if (error.isEmpty()) {
+                develCache[name].source = DevelSource::fromSrcInfo(srcinfo);
+            } else {
+                qWarning() << "Cannot fetch .SRCINFO of" << name << ":" << error;
+            }
+            if (pendingSrcInfo == 0) {
+                runDevelCheck();
+            }
+        });
+    }
+    if (pendingSrcInfo == 0) {
+        runDevelCheck();
+    }
+}
+
+void SystemMonitor::runDevelCheck() {
+    QHash<QString, DevelSource> sources;
+    for (auto it = develCache.cbegin(); it != develCache.cend(); ++it) {
+        if (const std::optional<DevelSource> source = DevelSource::parse(it->source)) {
+            sources.insert(it.key(), *source);
+        }
+    }
+    develCheckedAt = QDateTime::currentSecsSinceEpoch();
+    qWarning() << "Checking upstream revisions of" << sources.size() << "VCS packages";
+    develJob = new DevelCheckJob(sources, develCheckParallel, develAllowedSchemes, this);
+    connect(develJob, &DevelCheckJob::revisionFound, this, &SystemMonitor::onDevelRevision);
+    connect(develJob, &DevelCheckJob::finished, develJob, &QObject::deleteLater);
+    connect(develJob, &DevelCheckJob::finished, this, [this]() {
+        // One publish for the whole batch: each one rewrites the state file,
+        // broadcasts it and takes a GetStateSince() history slot
+        QJsonObject state = currentSnapshot()->state;
+        addDevelState(state);
+        publishState(state);
+        saveDevelCache();
+        noteActivity();
+    });
+    develJob->start();
+}
+
+void SystemMonitor::onDevelRevision(const QString& package, const QString& revision) {
+    DevelEntry& entry = develCache[package];
+    const QString localVersion = localDb->version(package);
+    // First sight, or rebuilt since: assume the installed build is current
+    if (entry.baseline.isEmpty() || entry.installedVersion != localVersion) {
+        entry.baseline = revision;
+        entry.installedVersion = localVersion;
+    }
+    entry.upstream = revision;
+}
+
+QList<PackageUpdate> SystemMonitor::develUpdatesFromCache() const {
+    QStringList names = develCache.keys();
+    names.sort();
+    QList<PackageUpdate> updates;
+    for (const QString& name : std::as_const(names)) {
+        const DevelEntry& entry = develCache[name];
+        const QString localVersion = localDb->version(name);
+        // A rebuild since the baseline was taken counts as up to date
+        if (localVersion.isEmpty() || entry.installedVersion != localVersion || entry.upstream == entry.baseline) {
+            continue;
+        }
+        PackageUpdate update;
+        update.name = name;
+        update.oldVersion = localVersion;
+        update.newVersion = entry.upstream.left(12);
+        update.repository = QStringLiteral("aur");
+        update.source = QStringLiteral("devel");
+        updates.append(update);
+    }
+    return updates;
+}
+
+void SystemMonitor::addDevelState(QJsonObject& state) const {
+    const QList<PackageUpdate> updates = develUpdatesFromCache();
+    state[QStringLiteral("devel_packages")] = packageUpdatesToJson(updates);
+    QJsonObject counts = state[QStringLiteral("counts")].toObject();
+    counts[QStringLiteral("devel")] = updates.size();
+    state[QStringLiteral("counts")] = counts;
+}
+
+void SystemMonitor::loadDevelCache() {
+    QFile file(DEVEL_CACHE_PATH);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    const QJsonObject cache = QJsonDocument::fromJson(file.readAll()).object();
+    develCheckedAt = cache[QStringLiteral("checked_at")].toInteger();
+    const QJsonObject packages = cache[QStringLiteral("packages")].toObject();
+    for (auto it = packages.constBegin(); it != packages.constEnd(); ++it) {
+        const QJsonObject record = it.value().toObject();
+        DevelEntry entry;
+        entry.source = record[QStringLiteral("source")].toString();
+        entry.baseline = record[QStringLiteral("baseline")].toString();
+        entry.upstream = record[QStringLiteral("upstream")].toString();
+        entry.installedVersion = record[QStringLiteral("installed")].toString();
+        develCache.insert(it.key(), entry);
+    }
+}
+
+void SystemMonitor::saveDevelCache() {
+    QJsonObject packages;
+    for (auto it = develCache.cbegin(); it != develCache.cend(); ++it) {
+        QJsonObject record;
+        record[QStringLiteral("source")] = it->source;
+        record[QStringLiteral("baseline")] = it->baseline;
+        record[QStringLiteral("upstream")] = it->upstream;
+        record[QStringLiteral("installed")] = it->installedVersion;
+        packages[it.key()] = record;
+    }
+    QJsonObject cache;
+    cache[QStringLiteral("checked_at")] = develCheckedAt;
+    cache[QStringLiteral("packages")] = packages;
+    QSaveFile file(DEVEL_CACHE_PATH);
+    if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(cache).toJson(QJsonDocument::Compact)) < 0 ||
+        !file.commit()) {
+        qWarning() << "Cannot write devel cache" << DEVEL_CACHE_PATH << ":" << file.errorString();
+    }
+}
+
+void SystemMonitor::startPrefetch() {
+    if ((prefetchJob && prefetchJob->isActive()) || isPacmanLocked()) {
+        return;
+    }
+    prefetchJob = new PrefetchJob(cacheDir, prefetchRateLimit, pacmanDbArgs(),
+                                  QDir(systemDbPath).filePath(QStringLiteral("db.lck")), this);
+    connect(prefetchJob, &PrefetchJob::progress, this, &SystemMonitor::onPrefetchProgress);
+    connect(prefetchJob, &PrefetchJob::finished, this, &SystemMonitor::onPrefetchFinished);
+    connect(prefetchJob, &PrefetchJob::finished, prefetchJob, &QObject::deleteLater);
+    connect(prefetchJob, &PrefetchJob::finished, this, &SystemMonitor::noteActivity);
+    prefetchJob->start();
 }
 
-QJsonObject SystemMonitor::buildState(const QStringList& repoLines, const QStringList& aurLines, bool aurEnabled, const QString& aurHelper) {
+void SystemMonitor::cancelPrefetch() {
+    prefetchPublishTimer->stop();
+    if (prefetchJob) {
+        prefetchJob->cancel();
+        prefetchJob = nullptr;
+    }
+}
+
+void SystemMonitor::onPrefetchProgress() {
+    // Every package changes status several times; each publish rewrites the
+    // state file, broadcasts it and takes a GetStateSince() history slot, so
+    // the changes go out together
+    if (sender() == prefetchJob && !prefetchPublishTimer->isActive()) {
+        prefetchPublishTimer->start();
+    }
+}
+
+void SystemMonitor::onPrefetchFinished() {
+    if (sender() != prefetchJob) {
+        return;
+    }
+    prefetchPublishTimer->stop();
+    publishPrefetchStatus();
+}
+
+void SystemMonitor::publishPrefetchStatus() {
+    if (!prefetchJob) {
+        return;
+    }
+    const QHash<QString, QString> statuses = prefetchJob->statuses();
+    QJsonObject state = currentSnapshot()->state;
+    QList<PackageUpdate> updates = packageUpdatesFromJson(state[QStringLiteral("packages")].toArray());
+    for (PackageUpdate& update : updates) {
+        update.prefetch = statuses.value(update.name, update.prefetch);
+    }
+    state[QStringLiteral("packages")] = packageUpdatesToJson(updates);
+    publishState(state);
+}
+
+QJsonObject SystemMonitor::buildJobState(RefreshJob* job, const QList<PackageUpdate>& aurUpdates, bool partial) {
+    QJsonObject newState = buildState(job->repoUpdates, aurUpdates, partial);
+    newState[QStringLiteral("db_fingerprint")] = job->dbFingerprint;
+    newState[QStringLiteral("cache_hit")] = job->cacheHit;
+    newState[QStringLiteral("remove_packages")] = job->removals;
+    newState[QStringLiteral("aur_checked_at")] = aurCheckedAt;
+    if (!job->aurError.isEmpty()) {
+        // The AUR part is the cached result; the repo part is current
+        newState[QStringLiteral("errors")] = QJsonArray{job->aurError};
+    }
+    if (job->aurEnabled) {
+        addDevelState(newState);
+    }
+    QJsonObject counts = newState[QStringLiteral("counts")].toObject();
+    counts[QStringLiteral("remove")] = job->removals.size();
+    newState[QStringLiteral("counts")] = counts;
+
+    // Settings the monitor keeps in the state carry over from check to check,
+    // including ones changed while this check was running
+    const QJsonObject& previous = currentSnapshot()->state;
+    for (const QString& key : {QStringLiteral("check_interval"), QStringLiteral("schedule"),
+                               QStringLiteral("aur_enabled"), QStringLiteral("aur_helper")}) {
+        if (previous.contains(key)) {
+            newState[key] = previous[key];
+        }
+    }
+    return newState;
+}
+
+void SystemMonitor::publishState(const QJsonObject& newState) {
+    //  Swap in the new snapshot (AUR settings already carried over by buildJobState)
+    const QString previousHash = currentSnapshot()->contentHash;
+    std::shared_ptr<const StateSnapshot> published = commitState(newState);
+    if (published->contentHash == previousHash) {
+        return; // Nothing a listener would act on changed
+    }
+    emit stateChanged(published->stateJson);
+    emit summaryChanged(published->summaryJson);
+}
+
+QJsonObject SystemMonitor::buildState(const QList<PackageUpdate>& repoUpdates, const QList<PackageUpdate>& aurUpdates, bool partial) {
     qint64 now = QDateTime::currentSecsSinceEpoch();
 
     //  Start with default state structure
@@ -399,51 +1433,39 @@ QJsonObject SystemMonitor::buildState(const QStringList& repoLines, const QStrin
     
     // Update with query results
     newState[QStringLiteral("checked_at")] = now;
-    newState[QStringLiteral("packages")] = QJsonArray::fromStringList(repoLines);
-    newState[QStringLiteral("aur_packages")] = QJsonArray::fromStringList(aurLines);
+    newState[QStringLiteral("packages")] = packageUpdatesToJson(repoUpdates);
+    newState[QStringLiteral("aur_packages")] = packageUpdatesToJson(aurUpdates);
 
     QJsonObject counts = newState[QStringLiteral("counts")].toObject();
-    counts[QStringLiteral("upgrade")] = repoLines.size();
-    counts[QStringLiteral("aur_upgrade")] = aurLines.size();
-    counts[QStringLiteral("total_upgrade")] = repoLines.size() + aurLines.size();
+    counts[QStringLiteral("upgrade")] = repoUpdates.size();
+    counts[QStringLiteral("aur_upgrade")] = aurUpdates.size();
+    counts[QStringLiteral("total_upgrade")] = repoUpdates.size() + aurUpdates.size();
+
+    // Held updates (IgnorePkg/IgnoreGroup) stay in the lists, flagged, so the
+    // viewer can show what is being held back
+    QJsonArray heldPackages;
+    for (const PackageUpdate& update : repoUpdates) {
+        if (update.held) {
+            heldPackages.append(update.name);
+        }
+    }
+    newState[QStringLiteral("held_packages")] = heldPackages;
 
-    // Note: Held packages count removed - pacman -Qu already excludes ignored packages
-    // Note: Replaced packages count removed - rarely used and expensive to calculate
-    counts[QStringLiteral("remove")] = 0;
-    counts[QStringLiteral("held")] = 0;
+    counts[QStringLiteral("held")] = heldPackages.size();
 
     newState[QStringLiteral("counts")] = counts;
     newState[QStringLiteral("status")] = QStringLiteral("ok");
-    
-    // Preserve AUR settings passed as parameters
-    newState[QStringLiteral("aur_enabled")] = aurEnabled;
-    newState[QStringLiteral("aur_helper")] = aurHelper;
+    // Repo results published while the AUR query is still running
+    newState[QStringLiteral("partial")] = partial;
 
     return newState;
 }
 
-QList<QJsonObject> SystemMonitor::parseUpdateLines(const QStringList& lines) {
-    QList<QJsonObject> updates;
+QList<PackageUpdate> SystemMonitor::parseUpdateLines(const QStringList& lines, const QString& source) {
+    QList<PackageUpdate> updates;
+    updates.reserve(lines.size());
     for (const QString& line : lines) {
-        QRegularExpressionMatch match = UPDATE_RE.match(line);
-        if (match.hasMatch()) {
-            QJsonObject update;
-            update[QStringLiteral("name")] = match.captured(1);
-            update[QStringLiteral("old")] = match.captured(2);
-            update[QStringLiteral("new")] = match.captured(3);
-            update[QStringLiteral("raw")] = line;
-            updates.append(update);
-        } else {
-            QStringView lineView(line);
-            qsizetype spaceIndex = lineView.indexOf(u' ');
-            QString name = (spaceIndex < 0 ? lineView : lineView.left(spaceIndex)).toString();
-            QJsonObject update;
-            update[QStringLiteral("name")] = name;
-            update[QStringLiteral("old")] = QStringLiteral("");
-            update[QStringLiteral("new")] = QStringLiteral("");
-            update[QStringLiteral("raw")] = line;
-            updates.append(update);
-        }
+        updates.append(PackageUpdate::fromLine(line, source));
     }
     return updates;
 }
@@ -452,11 +1474,17 @@ QJsonObject SystemMonitor::parsePacmanConf(const QString& path) {
     QJsonObject result;
     QJsonArray ignorePkg;
     QJsonArray ignoreGroup;
+    QJsonArray repos;
+    result[QStringLiteral("root_dir")] = QStringLiteral("/");
+    result[QStringLiteral("db_path")] = QStringLiteral("/var/lib/pacman/");
+    result[QStringLiteral("cache_dir")] = QStringLiteral("/var/cache/pacman/pkg/");
+    bool cacheDirSet = false;
 
     QFile file(path);
     if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
         result[QStringLiteral("ignore_pkg")] = ignorePkg;
         result[QStringLiteral("ignore_group")] = ignoreGroup;
+        result[QStringLiteral("repos")] = repos;
         return result;
     }
 
@@ -472,7 +1500,26 @@ QJsonObject SystemMonitor::parsePacmanConf(const QString& path) {
             continue;
         }
 
-        if (line.startsWith(QStringLiteral("IgnorePkg"))) {
+        if (line.startsWith(u'[') && line.endsWith(u']')) {
+            QString section = line.mid(1, line.size() - 2).trimmed();
+            if (section != QStringLiteral("options") && !section.isEmpty()) {
+                repos.append(section);
+            }
+        } else if (line.startsWith(QStringLiteral("DBPath")) || line.startsWith(QStringLiteral("RootDir"))) {
+            qsizetype equalsIndex = line.indexOf(u'=');
+            if (equalsIndex >= 0) {
+                QString key = line.startsWith(QStringLiteral("DBPath")) ? QStringLiteral("db_path") : QStringLiteral("root_dir");
+                result[key] = line.mid(equalsIndex + 1).trimmed();
+            }
+        } else if (line.startsWith(QStringLiteral("CacheDir"))) {
+            // pacman downloads into the first CacheDir
+            qsizetype equalsIndex = line.indexOf(u'=');
+            if (equalsIndex >= 0 && !cacheDirSet) {
+                result[QStringLiteral("cache_dir")] =
+                    line.mid(equalsIndex + 1).section(u' ', 0, 0, QString::SectionSkipEmpty);
+                cacheDirSet = true;
+            }
+        } else if (line.startsWith(QStringLiteral("IgnorePkg"))) {
             qsizetype equalsIndex = line.indexOf(u'=');
             QStringView value = equalsIndex >= 0 ? QStringView(line).mid(equalsIndex + 1).trimmed()
                                                  : QStringView();
@@ -493,94 +1540,6 @@ QJsonObject SystemMonitor::parsePacmanConf(const QString& path) {
 
     result[QStringLiteral("ignore_pkg")] = ignorePkg;
     result[QStringLiteral("ignore_group")] = ignoreGroup;
+    result[QStringLiteral("repos")] = repos;
     return result;
 }
-
-QString SystemMonitor::pacmanFieldOutput(const QStringList& args, const QString& field) {
-    QProcess process;
-    process.start(QStringLiteral("pacman"), args);
-    if (!process.waitForFinished(10000)) { // 10 second timeout
-        return QString();
-    }
-
-    if (process.exitCode() != 0) {
-        return QString();
-    }
-
-    QString output = QString::fromUtf8(process.readAllStandardOutput());
-    QStringView fieldView(field);
-    for (QStringView lineView : QStringTokenizer{output, u'\n'}) {
-        lineView = lineView.trimmed();
-        if (lineView.startsWith(fieldView)) {
-            qsizetype colonIndex = lineView.indexOf(u':');
-            if (colonIndex >= 0 && colonIndex + 1 < lineView.size()) {
-                return lineView.mid(colonIndex + 1).trimmed().toString();
-            }
-        }
-    }
-    return QString();
-}
-
-QString SystemMonitor::getLocalVersion(const QString& pkg) {
-    return pacmanFieldOutput(QStringList() << QStringLiteral("-Qi") << pkg, QStringLiteral("Version"));
-}
-
-QString SystemMonitor::getSyncVersion(const QString& pkg) {
-    return pacmanFieldOutput(QStringList() << QStringLiteral("-Si") << pkg, QStringLiteral("Version"));
-}
-
-bool SystemMonitor::isUpdateAvailable(const QString& pkg) {
-    QString localVer = getLocalVersion(pkg);
-    QString syncVer = getSyncVersion(pkg);
-
-    if (localVer.isEmpty() || syncVer.isEmpty()) {
-        return false;
-    }
-
-    QProcess process;
-    process.start(QStringLiteral("vercmp"), QStringList() << localVer << syncVer);
-    if (!process.waitForFinished(5000)) {
-        return false;
-    }
-
-    QString output = QString::fromUtf8(process.readAllStandardOutput()).trimmed();
-    return process.exitCode() == 0 && output == QStringLiteral("-1");
-}
-
-QStringList SystemMonitor::getReplacedPackages(const QString& pkg) {
-    QString replaces = pacmanFieldOutput(QStringList() << QStringLiteral("-Si") << pkg, QStringLiteral("Replaces"));
-    if (replaces.isEmpty() || replaces.toLower() == QStringLiteral("none")) {
-        return QStringList();
-    }
-
-    QStringList items;
-    for (QStringView item : QStringTokenizer{replaces, u' ', Qt::SkipEmptyParts}) {
-        QString cleanedItem = item.toString();
-        cleanedItem.remove(QStringLiteral(","));
-        items.append(cleanedItem);
-    }
-    return items;
-}
-
-QStringList SystemMonitor::getGroupPackages(const QString& group) {
-    QProcess process;
-    process.start(QStringLiteral("pacman"), QStringList() << QStringLiteral("-Sqg") << group);
-    if (!process.waitForFinished(10000)) {
-        return QStringList();
-    }
-
-    if (process.exitCode() != 0) {
-        return QStringList();
-    }
-
-    QString output = QString::fromUtf8(process.readAllStandardOutput());
-    QStringList packages;
-    packages.reserve(output.count(QLatin1Char('\n')) + 1);
-    for (QStringView lineView : QStringTokenizer{output, u'\n', Qt::SkipEmptyParts}) {
-        lineView = lineView.trimmed();
-        if (!lineView.isEmpty()) {
-            packages.append(lineView.toString());
-        }
-    }
-    return packages;
-}
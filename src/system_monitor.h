@@ -4,24 +4,66 @@
 #include <QTimer>
 #include <QJsonObject>
 #include <QDBusConnection>
-#include <QProcess>
-#include <QRegularExpression>
-#include <QMutex>
-#include <QMutexLocker>
-#include <QAtomicInteger>
+#include <QFileSystemWatcher>
+#include <QJsonArray>
+#include <QList>
+#include <QPointer>
+#include <QSet>
 #include <QStringList>
+#include <QThread>
+
+#include "aur_client.h"
+#include "check_gate.h"
+#include "check_scheduler.h"
+#include "dbus_types.h"
+#include "devel_check_job.h"
+#include "local_db_tracker.h"
+#include "prefetch_job.h"
+#include "refresh_job.h"
+#include "sync_index.h"
+#include "system_events.h"
+#include <memory>
+
+#ifdef HAVE_LIBALPM
+#include "alpm_backend.h"
+#endif
+
+// Immutable view of the monitor state. A refresh builds a new one and swaps
+// it in; readers keep whichever snapshot they fetched. The JSON payloads are
+// serialized once per generation.
+struct StateSnapshot {
+    QJsonObject state;
+    quint64 generation = 0; // Increases with every commit, also stored in state
+    QString contentHash;    // Ignores checked_at and other per-check fields
+    QString stateJson;
+    QString summaryJson;
+    UpdateSummary summary;  // Typed forms for GetSummary()/GetPackages()
+    QList<PackageRow> rows;
+};
 
 class SystemMonitor : public QObject {
     Q_OBJECT
     Q_CLASSINFO("D-Bus Interface", "org.mxlinux.UpdateNotifierSystemMonitor")
 
 public:
-    explicit SystemMonitor(bool requireChecksum = true);
+    // idleTimeout: seconds without calls or work before the process exits
+    // (it is D-Bus activated again on demand); 0 keeps it running
+    explicit SystemMonitor(bool requireChecksum = true, bool useAlpm = true, int idleTimeout = 0);
 
 public Q_SLOTS:
     QString GetState();
     QString GetStateSummary();
+    QString GetStateSince(qulonglong generation);
+    // Typed alternatives to the JSON methods: the counts, and a page of the
+    // pending updates (repo first, then AUR); limit 0 means to the end
+    UpdateSummary GetSummary();
+    QList<PackageRow> GetPackages(uint offset, uint limit);
+    // Sync database fields of one package (sizes, description, groups,
+    // dependencies) from the sync index; "{}" when unknown
+    QString GetPackageInfo(const QString& name);
     void Refresh();
+    void CancelRefresh();
+    QString GetRefreshStatus();
     void DelayRefresh(int seconds);
     void SetCheckInterval(int seconds);
     void SetRefreshPaused(bool paused);
@@ -30,37 +72,126 @@ public Q_SLOTS:
 Q_SIGNALS:
     void stateChanged(const QString& state);
     void summaryChanged(const QString& summary);
+    void refreshStatusChanged(const QString& status);
 
 private Q_SLOTS:
     void refresh();
+    void onJobStatusChanged();
+    void onPrefetchProgress();
+    void onPrefetchFinished();
+    void onDbDirChanged();
+    void onLockWaitExpired();
+    void onIdleTimeout();
+    void onResumed();
+    void onNetworkOnline();
 
 private:
-    void refresh(bool syncDb);
-    bool syncPacmanDb();
-    bool isUpdateAvailable(const QString& pkg);
+    void refresh(bool syncDb, bool online);
+    void startJob(RefreshJob* job);
+    void retryAfterLock(RefreshJob* job);
+    void stopLockWait();
+    void scheduleNextCheck();
+    void deferCheck(const QString& reason);
+    void noteActivity();
+    bool isBusy() const;
+    void startSync(RefreshJob* job);
+    void startRepoQuery(RefreshJob* job);
+    void startAurQuery(RefreshJob* job);
+    QStringList foreignPackages() const;
+    void queryAurRpc(RefreshJob* job, const QStringList& names, bool fullCheck);
+    void keepAurResult(RefreshJob* job);
+    QList<PackageUpdate> aurUpdatesFromCache() const;
+    void loadAurCache();
+    void saveAurCache();
+    void startDevelCheck();
+    void runDevelCheck();
+    void onDevelRevision(const QString& package, const QString& revision);
+    QList<PackageUpdate> develUpdatesFromCache() const;
+    void addDevelState(QJsonObject& state) const;
+    void loadDevelCache();
+    void saveDevelCache();
+    void onRepoQueryDone(RefreshJob* job);
+    void onAurQueryDone(RefreshJob* job);
+    void finishJob(RefreshJob* job);
+    void startFullRepoQuery(RefreshJob* job);
+    void startPacmanQuery(RefreshJob* job);
+    bool canUpdateIncrementally();
+    void updateSyncIndex(RefreshJob* job, const QSet<QString>& touched);
+    void updatePendingIncrementally(RefreshJob* job, const QSet<QString>& touched);
+    void scanRemovals(RefreshJob* job);
+    static void applyHeld(QList<PackageUpdate>& updates, const QStringList& patterns,
+                          const QSet<QString>& groupMembers);
+    void startPrefetch();
+    void cancelPrefetch();
+    void publishPrefetchStatus();
+    QJsonObject buildJobState(RefreshJob* job, const QList<PackageUpdate>& aurUpdates, bool partial);
+    void publishState(const QJsonObject& newState);
+    static std::shared_ptr<const StateSnapshot> makeSnapshot(const QJsonObject& state, quint64 generation);
+    std::shared_ptr<const StateSnapshot> currentSnapshot() const;
+    std::shared_ptr<const StateSnapshot> commitState(const QJsonObject& state);
+    static QJsonObject diffPackages(const QJsonArray& before, const QJsonArray& after);
+    static bool isLockError(const ProcessResult& result);
     bool isPacmanLocked() const;
-    QJsonObject buildState(const QStringList& repoLines, const QStringList& aurLines, bool aurEnabled, const QString& aurHelper);
+    bool preparePrivateDb();
+    QString activeDbPath() const;
+    QStringList pacmanDbArgs() const;
+    QJsonObject buildState(const QList<PackageUpdate>& repoUpdates, const QList<PackageUpdate>& aurUpdates, bool partial);
     QJsonObject parsePacmanConf(const QString& path = QStringLiteral("/etc/pacman.conf"));
-    QList<QJsonObject> parseUpdateLines(const QStringList& lines);
-    QString getLocalVersion(const QString& pkg);
-    QString getSyncVersion(const QString& pkg);
-    QString pacmanFieldOutput(const QStringList& args, const QString& field);
-    QStringList getGroupPackages(const QString& group);
-    QStringList getReplacedPackages(const QString& pkg);
-    QStringList runPacmanQuery();
-    QStringList runAurQuery(QString& aurHelper);
+    static QList<PackageUpdate> parseUpdateLines(const QStringList& lines, const QString& source);
 
     bool requireChecksum;
-    QString cachedStateJson; // Cache serialized JSON to avoid repeated serialization
-    qint64 lastStateChange;  // Track when state was last modified
-    QString cachedSummaryJson; // Cache summary JSON to avoid repeated serialization
-    qint64 lastSummaryChange;  // Track when summary was last modified
+    std::shared_ptr<const StateSnapshot> snapshot; // Only touched on the main thread
+    QList<std::shared_ptr<const StateSnapshot>> history; // Recent generations for GetStateSince()
+    static constexpr int MAX_STATE_HISTORY = 8;
     QTimer* checkTimer;
-    int checkInterval;
+    CheckScheduler scheduler;
+    SystemEvents* systemEvents;
+    CheckGate checkGate; // Holds back scheduled checks under load, on battery or metered links
+    int aurCheckInterval; // Seconds between AUR queries, independent of the repo checks
+    AurClient* aurClient; // Settings/aur_rpc_url
+    QHash<QString, QString> aurVersions; // AUR version per foreign package ("" if not in the AUR)
+    qint64 aurCheckedAt = 0;             // Last full AUR query; both persisted in AUR_CACHE_PATH
+    // VCS packages: the upstream revision seen when the installed version was
+    // first checked (baseline) and the latest one; they differ once upstream
+    // moved on. Persisted in DEVEL_CACHE_PATH.
+    struct DevelEntry {
+        QString source; // From .SRCINFO; empty if the package has no VCS source
+        QString baseline;
+        QString upstream;
+        QString installedVersion; // Local version the baseline belongs to
+    };
+    QHash<QString, DevelEntry> develCache;
+    qint64 develCheckedAt = 0;
+    bool develCheckEnabled;  // Settings/devel_check_enabled
+    int develCheckParallel;  // Settings/devel_check_parallel
+    QStringList develAllowedSchemes; // Settings/devel_allowed_protocols
+    QPointer<DevelCheckJob> develJob;
+    int pendingSrcInfo = 0;
+    bool waitingForNetwork = false; // A scheduled check was deferred while offline
     int pendingUpgradeCount;
     bool refreshPaused = false;
-    bool refreshDelayed = false;
-    QAtomicInteger<bool> refreshRetryScheduled;
-    QMutex stateMutex;
-    static const QRegularExpression UPDATE_RE;
+    bool privateSyncDb;   // Sync into PRIVATE_DB_PATH instead of the system sync DBs
+    QString systemDbPath; // DBPath from pacman.conf
+    QPointer<RefreshJob> currentJob; // Running job, or the last one until the next starts
+    bool prefetchEnabled;   // Download pending repo packages into the cache after a check
+    int prefetchRateLimit;  // KiB/s, 0 for no cap
+    QString cacheDir;       // First CacheDir from pacman.conf
+    QPointer<PrefetchJob> prefetchJob;
+    QTimer* prefetchPublishTimer; // Coalesces prefetch status changes into one publish
+    QSet<QString> heldGroupMembers; // Packages of IgnoreGroup groups, from the last sync DB scan
+    SyncIndex syncIndex; // Mapped decode of the sync DBs, rebuilt by scanRemovals()
+    LocalDbTracker* localDb;
+    QString resultSyncFingerprint; // Sync DBs behind the published repo result; empty if unusable
+    quint64 lastJobId = 0;
+    // Waiting for db.lck: the DB directory is watched instead of polled
+    QFileSystemWatcher* lockWatcher;
+    QTimer* lockDeadlineTimer;
+    QPointer<RefreshJob> lockWaiter;
+    int lockWaitTimeout; // Seconds a check may wait for the lock before failing
+    int idleTimeout;
+    QTimer* idleTimer;
+#ifdef HAVE_LIBALPM
+    std::shared_ptr<AlpmBackend> alpm; // In-process queries; null when disabled or unavailable
+    QPointer<QThread> alpmWorker;      // Running query on the handle, if any
+#endif
 };
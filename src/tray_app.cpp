@@ -1,10 +1,12 @@
 #include "tray_app.h"
 #include "common.h"
+#include "dbus_types.h"
 #include "history_dialog.h"
 #include "settings_dialog.h"
 #include "settings_service.h"
 #include "tray_service.h"
 #include <QDBusConnection>
+#include <QDBusConnectionInterface>
 #include <QDBusReply>
 #include <QDebug>
 #include <QJsonArray>
@@ -128,6 +130,7 @@ void TrayApp::setupActions() {
 }
 
 void TrayApp::setupDBus() {
+  registerDBusTypes();
   iface =
       new QDBusInterface(SYSTEM_DBUS_SERVICE, SYSTEM_DBUS_PATH, SYSTEM_DBUS_INTERFACE,
                          QDBusConnection::systemBus(), this);
@@ -159,11 +162,20 @@ void TrayApp::setupDBus() {
       this,
       SLOT(onSystemMonitorServiceChanged(QString, QString, QString)));
 
-  // Keep polling as fallback (every 15 minutes) in case signals are missed
+  // Poll as fallback (every 15 minutes) in case signals are missed, but only
+  // while the monitor runs: a call would D-Bus activate it again after it
+  // exited idle. onSystemMonitorServiceChanged() starts and stops the timer.
   connect(pollTimer, &QTimer::timeout, this, &TrayApp::pollState);
-  pollTimer->start(15 * 60 * 1000); // Poll every 15 minutes as fallback
+  pollTimer->setInterval(15 * 60 * 1000);
 
-  refresh();
+  // The monitor runs a check on its own when one is due; just show its state
+  pollState();
+  QDBusConnectionInterface *busInterface = QDBusConnection::systemBus().interface();
+  if (busInterface &&
+      busInterface->isServiceRegistered(
+          QStringLiteral("org.mxlinux.UpdateNotifierSystemMonitor"))) {
+    pollTimer->start();
+  }
 }
 
 void TrayApp::registerTrayService() {
@@ -250,6 +262,13 @@ void TrayApp::pollState() {
     return;
   }
 
+  QDBusReply<UpdateSummary> summary = iface->call(QStringLiteral("GetSummary"));
+  if (summary.isValid()) {
+    applySummary(summary.value());
+    return;
+  }
+
+  // Monitor without the typed API
   QDBusReply<QString> reply = iface->call(QStringLiteral("GetStateSummary"));
   if (reply.isValid()) {
     onSummaryChanged(reply.value());
@@ -265,12 +284,21 @@ void TrayApp::onSummaryChanged(const QString &payload) {
   }
 
   QJsonObject counts = doc.object()[QStringLiteral("counts")].toObject();
-  upgradesCount =
-      counts[QStringLiteral("total_upgrade")].toInt(); // Use total including AUR
-  repoCount = counts[QStringLiteral("upgrade")].toInt();
-  aurCount = counts[QStringLiteral("aur_upgrade")].toInt();
-  removeCount = counts[QStringLiteral("remove")].toInt();
-  heldCount = counts[QStringLiteral("held")].toInt();
+  UpdateSummary summary;
+  summary.upgrade = counts[QStringLiteral("upgrade")].toInt();
+  summary.aurUpgrade = counts[QStringLiteral("aur_upgrade")].toInt();
+  summary.totalUpgrade = counts[QStringLiteral("total_upgrade")].toInt();
+  summary.remove = counts[QStringLiteral("remove")].toInt();
+  summary.held = counts[QStringLiteral("held")].toInt();
+  applySummary(summary);
+}
+
+void TrayApp::applySummary(const UpdateSummary &summary) {
+  upgradesCount = summary.totalUpgrade; // Use total including AUR
+  repoCount = summary.upgrade;
+  aurCount = summary.aurUpgrade;
+  removeCount = summary.remove;
+  heldCount = summary.held;
   updateUI();
 }
 
@@ -478,7 +506,7 @@ void TrayApp::launchBin(const QString &name) {
 void TrayApp::quit() { app->quit(); }
 
 bool TrayApp::isPackageInstalled(const QString &packageName) const {
-  return !QStandardPaths::findExecutable(packageName).isEmpty();
+  return !resolveExecutable(packageName).isEmpty();
 }
 
 void TrayApp::autoEnableTrayService() {
@@ -519,13 +547,19 @@ void TrayApp::onSystemMonitorServiceChanged(const QString &name, const QString &
   Q_UNUSED(name);
   // If oldOwner is not empty and newOwner is not empty, the service restarted
   // If oldOwner is empty and newOwner is not empty, the service started
-  if (!newOwner.isEmpty()) {
-    qDebug() << "System monitor service (re)started, re-syncing AUR settings";
-    if (settingsService) {
-      // Re-sync settings to the restarted service
-      settingsService->initializeSystemMonitor();
-    }
-    // Refresh the UI to get the latest state
-    refresh();
+  // If newOwner is empty, the service exited (idle timeout); its state
+  // arrives again with the next start
+  if (newOwner.isEmpty()) {
+    pollTimer->stop();
+    return;
+  }
+  pollTimer->start();
+  qDebug() << "System monitor service (re)started, re-syncing AUR settings";
+  if (settingsService) {
+    // Re-sync settings to the restarted service
+    settingsService->initializeSystemMonitor();
   }
+  // Show the restored state. The monitor is D-Bus activated on demand and
+  // decides itself whether a check is due, so do not force one here.
+  pollState();
 }
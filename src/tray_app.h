@@ -15,6 +15,7 @@ class TrayService;
 class SettingsService;
 class SettingsDialog;
 class HistoryDialog;
+struct UpdateSummary;
 
 class TrayApp : public QObject {
   Q_OBJECT
@@ -45,6 +46,7 @@ private Q_SLOTS:
   void updateUI();
 
 private:
+  void applySummary(const UpdateSummary &summary);
   void launchBin(const QString &name);
   void updatePackageManagerAction();
   bool isPackageInstalled(const QString &packageName) const;
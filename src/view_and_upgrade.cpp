@@ -45,6 +45,45 @@ QStringList shellQuoteArguments(const QStringList &args) {
     }
     return quoted;
 }
+
+QMap<QString, QJsonValue> entriesByName(const QJsonArray &entries) {
+    QMap<QString, QJsonValue> byName;
+    for (const QJsonValue &value : entries) {
+        byName.insert(packageEntryName(value), value);
+    }
+    return byName;
+}
+
+bool applyPackageDelta(QMap<QString, QJsonValue> &entries, const QJsonObject &delta) {
+    const QJsonArray removed = delta[QStringLiteral("removed")].toArray();
+    const QJsonArray added = delta[QStringLiteral("added")].toArray();
+    const QJsonArray changed = delta[QStringLiteral("changed")].toArray();
+    for (const QJsonValue &name : removed) {
+        entries.remove(name.toString());
+    }
+    for (const QJsonArray &values : {added, changed}) {
+        for (const QJsonValue &value : values) {
+            entries.insert(packageEntryName(value), value);
+        }
+    }
+    return !removed.isEmpty() || !added.isEmpty() || !changed.isEmpty();
+}
+
+const int PackageNameRole = Qt::UserRole + 1;
+
+QString packageItemText(const PackageUpdate &update) {
+    QString text = QStringLiteral("%1 %2 -> %3").arg(update.name, update.oldVersion, update.newVersion);
+    if (!update.repository.isEmpty() && update.source != QStringLiteral("aur")) {
+        text += QStringLiteral(" [%1]").arg(update.repository);
+    }
+    if (update.held) {
+        text += QStringLiteral(" (held)");
+    }
+    if (update.prefetch == QStringLiteral("ready")) {
+        text += QStringLiteral(" (downloaded)");
+    }
+    return text;
+}
 } // namespace
 
 ViewAndUpgrade::ViewAndUpgrade(QWidget* parent)
@@ -148,6 +187,12 @@ void ViewAndUpgrade::setupDBus() {
         QDBusConnection::systemBus(),
         this
     );
+
+    // Refresh() only starts a job in the monitor; reload once it has ended
+    QDBusConnection::systemBus().connect(
+        SYSTEM_DBUS_SERVICE, SYSTEM_DBUS_PATH, SYSTEM_DBUS_INTERFACE,
+        QStringLiteral("refreshStatusChanged"),
+        this, SLOT(onRefreshStatusChanged(QString)));
 }
 
 void ViewAndUpgrade::refresh() {
@@ -162,17 +207,30 @@ void ViewAndUpgrade::refresh() {
     auto *watcher = new QDBusPendingCallWatcher(pending, this);
     connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, watcher]() {
         watcher->deleteLater();
-        loadState();
+        if (watcher->isError()) {
+            loadState();
+        }
     });
 }
 
+void ViewAndUpgrade::onRefreshStatusChanged(const QString& payload) {
+    QJsonObject status = QJsonDocument::fromJson(payload.toUtf8()).object();
+    const QString name = status[QStringLiteral("status")].toString();
+    if (name == QStringLiteral("finished") || name == QStringLiteral("cancelled") ||
+        name == QStringLiteral("failed")) {
+        loadState();
+    }
+}
+
 void ViewAndUpgrade::loadState() {
     if (!iface || !iface->isValid()) {
         countsLabel->setText(QStringLiteral("System monitor is not available."));
         return;
     }
 
-    QDBusPendingCall pending = iface->asyncCall(QStringLiteral("GetState"));
+    // Only fetch what changed since the generation we already have
+    QDBusPendingCall pending = iface->asyncCall(QStringLiteral("GetStateSince"),
+                                                static_cast<qulonglong>(knownGeneration));
     auto *watcher = new QDBusPendingCallWatcher(pending, this);
     connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, watcher]() {
         QDBusPendingReply<QString> reply = *watcher;
@@ -198,21 +256,46 @@ void ViewAndUpgrade::applyState(const QString& payload) {
         return;
     }
 
-    QJsonObject state = doc.object();
-    QJsonObject counts = state[QStringLiteral("counts")].toObject();
-
-    int repoCount = counts[QStringLiteral("upgrade")].toInt();
-    int aurCount = counts[QStringLiteral("aur_upgrade")].toInt();
-    int totalCount = counts[QStringLiteral("total_upgrade")].toInt();
+    QJsonObject delta = doc.object();
+    bool packagesChanged = true;
+    if (delta[QStringLiteral("full")].toBool()) {
+        knownState = delta[QStringLiteral("state")].toObject();
+        repoEntries = entriesByName(knownState[QStringLiteral("packages")].toArray());
+        aurEntries = entriesByName(knownState[QStringLiteral("aur_packages")].toArray());
+    } else {
+        bool repoChanged = applyPackageDelta(repoEntries, delta[QStringLiteral("packages")].toObject());
+        bool aurChanged = applyPackageDelta(aurEntries, delta[QStringLiteral("aur_packages")].toObject());
+        bool removalsChanged = knownState[QStringLiteral("remove_packages")] != delta[QStringLiteral("remove_packages")];
+        packagesChanged = repoChanged || aurChanged || removalsChanged;
+        for (const QString& key : {QStringLiteral("counts"), QStringLiteral("status"),
+                                   QStringLiteral("checked_at"), QStringLiteral("partial"),
+                                   QStringLiteral("remove_packages")}) {
+            knownState[key] = delta[key];
+        }
+    }
+    knownGeneration = static_cast<quint64>(delta[QStringLiteral("generation")].toInteger());
 
+    QJsonObject counts = knownState[QStringLiteral("counts")].toObject();
     QString countsText = QString(QStringLiteral("Upgrades: %1 repo + %2 AUR (%3 total) | Remove: %4 | Held: %5"))
-        .arg(repoCount)
-        .arg(aurCount)
-        .arg(totalCount)
+        .arg(counts[QStringLiteral("upgrade")].toInt())
+        .arg(counts[QStringLiteral("aur_upgrade")].toInt())
+        .arg(counts[QStringLiteral("total_upgrade")].toInt())
         .arg(counts[QStringLiteral("remove")].toInt())
         .arg(counts[QStringLiteral("held")].toInt());
     countsLabel->setText(countsText);
 
+    // Rebuilding the tree would reset the user's selection, so only do it
+    // when the package lists actually changed
+    if (packagesChanged || treeWidget->topLevelItemCount() == 0) {
+        renderState();
+    }
+}
+
+void ViewAndUpgrade::renderState() {
+    QJsonObject counts = knownState[QStringLiteral("counts")].toObject();
+    int repoCount = counts[QStringLiteral("upgrade")].toInt();
+    int aurCount = counts[QStringLiteral("aur_upgrade")].toInt();
+
     treeWidget->clear();
 
     // Create repository updates branch
@@ -224,10 +307,11 @@ void ViewAndUpgrade::applyState(const QString& payload) {
         repoItem->setCheckState(0, Qt::Checked);
         repoItem->setData(0, Qt::UserRole, QStringLiteral("repo_branch"));
 
-        QJsonArray packages = state[QStringLiteral("packages")].toArray();
-        for (const QJsonValue& value : packages) {
+        for (const QJsonValue& value : std::as_const(repoEntries)) {
+            const PackageUpdate update = PackageUpdate::fromJson(value);
             QTreeWidgetItem* item = new QTreeWidgetItem(repoItem);
-            item->setText(0, value.toString());
+            item->setText(0, packageItemText(update));
+            item->setData(0, PackageNameRole, update.name);
             item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
             item->setCheckState(0, Qt::Checked);
             item->setData(0, Qt::UserRole, QStringLiteral("repo_package"));
@@ -243,19 +327,40 @@ void ViewAndUpgrade::applyState(const QString& payload) {
         aurItem->setCheckState(0, Qt::Checked);
         aurItem->setData(0, Qt::UserRole, QStringLiteral("aur_branch"));
 
-        QJsonArray aurPackages = state[QStringLiteral("aur_packages")].toArray();
-        for (const QJsonValue& value : aurPackages) {
+        for (const QJsonValue& value : std::as_const(aurEntries)) {
+            const PackageUpdate update = PackageUpdate::fromJson(value);
             QTreeWidgetItem* item = new QTreeWidgetItem(aurItem);
-            item->setText(0, value.toString());
+            item->setText(0, packageItemText(update));
+            item->setData(0, PackageNameRole, update.name);
             item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
             item->setCheckState(0, Qt::Checked);
             item->setData(0, Qt::UserRole, QStringLiteral("aur_package"));
         }
     }
 
+    // Packages the upgrade would take away; informational, not selectable
+    const QJsonArray removals = knownState[QStringLiteral("remove_packages")].toArray();
+    QTreeWidgetItem* removeItem = nullptr;
+    if (!removals.isEmpty()) {
+        removeItem = new QTreeWidgetItem(treeWidget);
+        removeItem->setText(0, QStringLiteral("Will Be Removed (%1)").arg(removals.size()));
+        removeItem->setData(0, Qt::UserRole, QStringLiteral("remove_branch"));
+
+        for (const QJsonValue& value : removals) {
+            const QJsonObject removal = value.toObject();
+            const QString by = removal[QStringLiteral("by")].toString();
+            QTreeWidgetItem* item = new QTreeWidgetItem(removeItem);
+            item->setText(0, removal[QStringLiteral("reason")].toString() == QStringLiteral("replaced")
+                                 ? QStringLiteral("%1 (replaced by %2)").arg(removal[QStringLiteral("name")].toString(), by)
+                                 : QStringLiteral("%1 (conflicts with %2)").arg(removal[QStringLiteral("name")].toString(), by));
+            item->setData(0, Qt::UserRole, QStringLiteral("remove_package"));
+        }
+    }
+
     // Expand branches by default
     if (repoItem) repoItem->setExpanded(true);
     if (aurItem) aurItem->setExpanded(true);
+    if (removeItem) removeItem->setExpanded(true);
 
     // Update Select All checkbox state
     selectAllCheckbox->setChecked(true);
@@ -305,7 +410,7 @@ bool ViewAndUpgrade::launchInTerminal(const QString& command, const QStringList&
 
     for (const QString& terminal : terminals) {
         // Check if terminal is available
-        if (!QStandardPaths::findExecutable(terminal).isEmpty()) {
+        if (!resolveExecutable(terminal).isEmpty()) {
             // Terminal is available, try to launch it
             QStringList terminalArgs;
 
@@ -379,13 +484,7 @@ void ViewAndUpgrade::upgrade() {
         QString itemType = item->data(0, Qt::UserRole).toString();
 
         if (itemType == QStringLiteral("repo_package") || itemType == QStringLiteral("aur_package")) {
-            // Extract package name (first word before space)
-            QString packageInfo = item->text(0);
-            QStringView infoView(packageInfo);
-            qsizetype spaceIndex = infoView.indexOf(u' ');
-            QString packageName =
-                (spaceIndex < 0 ? infoView : infoView.left(spaceIndex))
-                    .toString();
+            QString packageName = item->data(0, PackageNameRole).toString();
 
             if (itemType == QStringLiteral("repo_package")) {
                 repoPackages.append(packageName);
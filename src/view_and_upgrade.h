@@ -14,6 +14,9 @@
 #include <QProgressBar>
 #include <QStackedLayout>
 #include <QTimer>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QMap>
 
 class ViewAndUpgrade : public QDialog {
     Q_OBJECT
@@ -31,11 +34,13 @@ private Q_SLOTS:
     void upgrade();
     void onSelectAllToggled(bool checked);
     void onTreeItemChanged(QTreeWidgetItem* item, int column);
+    void onRefreshStatusChanged(const QString& payload);
 
 private:
     bool launchInTerminal(const QString& command, const QStringList& args, QProcess** monitorProcess = nullptr);
     void loadState();
     void applyState(const QString& payload);
+    void renderState();
     void setRefreshing(bool refreshing);
 
 private:
@@ -54,4 +59,10 @@ private:
     QDBusInterface* iface;
     QTimer* refreshTimer = nullptr;
     bool suppressItemChanged = false;
+
+    // Last state received from the monitor, kept in sync through GetStateSince()
+    quint64 knownGeneration = 0;
+    QJsonObject knownState;
+    QMap<QString, QJsonValue> repoEntries;
+    QMap<QString, QJsonValue> aurEntries;
 };
@@ -0,0 +1,66 @@
+#include "common.h"
+#include <QTest>
+#include <vector>
+
+// Times vercmpBatch() over 2,000 (local, sync) pairs shaped like a sync's
+// worth of pending updates: mostly equal versions, some newer pkgrel or
+// pkgver, a few epochs and pre-release tags
+class BenchVercmp : public QObject {
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void batch();
+
+private:
+    static constexpr int PAIR_COUNT = 2000;
+    QStringList locals;
+    QStringList syncs;
+};
+
+void BenchVercmp::initTestCase() {
+    for (int i = 0; i < PAIR_COUNT; ++i) {
+        const QString version = QStringLiteral("%1.%2.%3").arg(i % 7).arg(i % 31).arg(i % 101);
+        QString local = version + QStringLiteral("-1");
+        QString sync = local;
+        switch (i % 10) {
+        case 0:
+            sync = version + QStringLiteral("-2");
+            break;
+        case 1:
+            sync = QStringLiteral("%1.%2.%3-1").arg(i % 7).arg(i % 31).arg(i % 101 + 1);
+            break;
+        case 2:
+            sync = QStringLiteral("1:") + local;
+            break;
+        case 3:
+            local = version + QStringLiteral("rc1-1");
+            break;
+        case 4:
+            local = version + QStringLiteral(".r1234.g0123abc-1");
+            sync = version + QStringLiteral(".r1240.g4567def-1");
+            break;
+        default:
+            break;
+        }
+        locals.append(local);
+        syncs.append(sync);
+    }
+}
+
+void BenchVercmp::batch() {
+    std::vector<VersionPair> pairs;
+    pairs.reserve(PAIR_COUNT);
+    for (int i = 0; i < PAIR_COUNT; ++i) {
+        pairs.push_back({locals.at(i), syncs.at(i)});
+    }
+    std::vector<int> results(pairs.size());
+    QBENCHMARK {
+        vercmpBatch(pairs, results);
+    }
+    QCOMPARE(results[0], -1);
+    QCOMPARE(results[5], 0);
+}
+
+QTEST_GUILESS_MAIN(BenchVercmp)
+#include "bench_vercmp.moc"
@@ -0,0 +1,269 @@
+#include "aur_client.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkProxy>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTest>
+#include <memory>
+
+// Minimal HTTP/1.1 server standing in for the AUR: answers RPC info POSTs
+// from a fixed name -> version table and records what each request asked for
+class AurStandIn : public QObject {
+    Q_OBJECT
+
+public:
+    struct Request {
+        QByteArray method;
+        QByteArray target;
+        QByteArray contentType;
+        QStringList names; // Decoded arg[] values of a POST
+    };
+
+    AurStandIn() {
+        connect(&server, &QTcpServer::newConnection, this, &AurStandIn::onNewConnection);
+    }
+
+    bool listen() { return server.listen(QHostAddress::LocalHost); }
+    QUrl rpcUrl() const {
+        return QUrl(QStringLiteral("http://127.0.0.1:%1/rpc/v5/info").arg(server.serverPort()));
+    }
+
+    QHash<QString, QString> known;
+    QByteArray srcInfo;
+    int status = 200;
+    QByteArray errorBody; // Sent instead of results when set
+    QList<Request> requests;
+    int connections = 0;
+
+private:
+    void onNewConnection() {
+        while (QTcpSocket* socket = server.nextPendingConnection()) {
+            ++connections;
+            connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+            connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        }
+    }
+
+    void onReadyRead(QTcpSocket* socket) {
+        QByteArray& buffer = buffers[socket];
+        buffer += socket->readAll();
+        // Keep-alive: several requests may arrive on one connection
+        for (;;) {
+            const qsizetype headerEnd = buffer.indexOf("\r\n\r\n");
+            if (headerEnd < 0) {
+                return;
+            }
+            Request request;
+            qsizetype contentLength = 0;
+            const QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+            const QList<QByteArray> requestLine = lines.value(0).trimmed().split(' ');
+            request.method = requestLine.value(0);
+            request.target = requestLine.value(1);
+            for (const QByteArray& line : lines.mid(1)) {
+                const qsizetype colon = line.indexOf(':');
+                const QByteArray key = line.left(colon).trimmed().toLower();
+                const QByteArray value = line.mid(colon + 1).trimmed();
+                if (key == "content-length") {
+                    contentLength = value.toLongLong();
+                } else if (key == "content-type") {
+                    request.contentType = value;
+                }
+            }
+            if (buffer.size() < headerEnd + 4 + contentLength) {
+                return;
+            }
+            const QByteArray body = buffer.mid(headerEnd + 4, contentLength);
+            buffer.remove(0, headerEnd + 4 + contentLength);
+            for (const QByteArray& pair : body.split('&')) {
+                if (pair.startsWith("arg%5B%5D=")) {
+                    QByteArray value = pair.mid(10);
+                    value.replace('+', ' ');
+                    request.names.append(QUrl::fromPercentEncoding(value));
+                }
+            }
+            requests.append(request);
+            respond(socket, request);
+        }
+    }
+
+    void respond(QTcpSocket* socket, const Request& request) {
+        QByteArray body;
+        if (request.method == "GET") {
+            body = srcInfo;
+        } else if (!errorBody.isEmpty()) {
+            body = errorBody;
+        } else {
+            QJsonArray results;
+            for (const QString& name : request.names) {
+                if (known.contains(name)) {
+                    results.append(QJsonObject{{QStringLiteral("Name"), name},
+                                               {QStringLiteral("Version"), known.value(name)}});
+                }
+            }
+            const QJsonObject response{{QStringLiteral("type"), QStringLiteral("multiinfo")},
+                                       {QStringLiteral("resultcount"), results.size()},
+                                       {QStringLiteral("results"), results}};
+            body = QJsonDocument(response).toJson(QJsonDocument::Compact);
+        }
+        socket->write("HTTP/1.1 " + QByteArray::number(status) + (status == 200 ? " OK" : " Error") +
+                      "\r\nContent-Type: application/json\r\nContent-Length: " + QByteArray::number(body.size()) +
+                      "\r\n\r\n" + body);
+    }
+
+    QTcpServer server;
+    QHash<QTcpSocket*, QByteArray> buffers;
+};
+
+class TestAurClient : public QObject {
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void batches();
+    void encoding();
+    void emptyQuery();
+    void errorResponse();
+    void httpError();
+    void srcInfo();
+
+private:
+    struct Result {
+        bool done = false;
+        QHash<QString, QString> versions;
+        QString error;
+    };
+    void query(AurClient& client, const QStringList& names, Result& result);
+
+    std::unique_ptr<AurStandIn> aur;
+};
+
+void TestAurClient::initTestCase() {
+    // The stand-in is on localhost; an http_proxy from the environment must not apply
+    QNetworkProxy::setApplicationProxy(QNetworkProxy::NoProxy);
+}
+
+void TestAurClient::init() {
+    aur = std::make_unique<AurStandIn>();
+    QVERIFY(aur->listen());
+}
+
+void TestAurClient::query(AurClient& client, const QStringList& names, Result& result) {
+    client.queryVersions(names, [&result](const QHash<QString, QString>& versions, const QString& error) {
+        result.done = true;
+        result.versions = versions;
+        result.error = error;
+    });
+}
+
+void TestAurClient::batches() {
+    QStringList names;
+    for (int i = 0; i < 450; ++i) {
+        names.append(QStringLiteral("package-%1").arg(i, 3, 10, QLatin1Char('0')));
+    }
+    aur->known.insert(QStringLiteral("package-007"), QStringLiteral("1.2-1"));
+    aur->known.insert(QStringLiteral("package-250"), QStringLiteral("1:3.0-2"));
+    aur->known.insert(QStringLiteral("package-449"), QStringLiteral("0.1.r5.gabc-1"));
+
+    AurClient client(aur->rpcUrl());
+    Result result;
+    query(client, names, result);
+    QVERIFY(client.isActive());
+    QTRY_VERIFY(result.done);
+    QCOMPARE(result.error, QString());
+    QVERIFY(!client.isActive());
+
+    // Sequential batches of 200 POSTed as form data over one connection
+    QCOMPARE(aur->requests.size(), 3);
+    QCOMPARE(aur->requests[0].names.size(), 200);
+    QCOMPARE(aur->requests[1].names.size(), 200);
+    QCOMPARE(aur->requests[2].names.size(), 50);
+    QStringList sent;
+    for (const AurStandIn::Request& request : std::as_const(aur->requests)) {
+        QCOMPARE(request.method, QByteArray("POST"));
+        QCOMPARE(request.target, QByteArray("/rpc/v5/info"));
+        QCOMPARE(request.contentType, QByteArray("application/x-www-form-urlencoded"));
+        sent += request.names;
+    }
+    QCOMPARE(sent, names);
+    QCOMPARE(aur->connections, 1);
+
+    QCOMPARE(result.versions.size(), 3);
+    QCOMPARE(result.versions.value(QStringLiteral("package-007")), QStringLiteral("1.2-1"));
+    QCOMPARE(result.versions.value(QStringLiteral("package-250")), QStringLiteral("1:3.0-2"));
+    QCOMPARE(result.versions.value(QStringLiteral("package-449")), QStringLiteral("0.1.r5.gabc-1"));
+}
+
+void TestAurClient::encoding() {
+    // '+' would turn into a space if it were not percent-encoded
+    const QStringList names = {QStringLiteral("libc++"), QStringLiteral("gtk+2"), QStringLiteral("a&b=c")};
+    for (const QString& name : names) {
+        aur->known.insert(name, QStringLiteral("1-1"));
+    }
+    AurClient client(aur->rpcUrl());
+    Result result;
+    query(client, names, result);
+    QTRY_VERIFY(result.done);
+    QCOMPARE(result.error, QString());
+    QCOMPARE(aur->requests.size(), 1);
+    QCOMPARE(aur->requests[0].names, names);
+    QCOMPARE(result.versions.size(), 3);
+}
+
+void TestAurClient::emptyQuery() {
+    AurClient client(aur->rpcUrl());
+    Result result;
+    query(client, QStringList(), result);
+    QVERIFY(result.done); // Answered right away
+    QCOMPARE(result.error, QString());
+    QVERIFY(result.versions.isEmpty());
+    QVERIFY(aur->requests.isEmpty());
+}
+
+void TestAurClient::errorResponse() {
+    aur->errorBody = R"({"type":"error","error":"Too many package names."})";
+    AurClient client(aur->rpcUrl());
+    Result result;
+    query(client, QStringList() << QStringLiteral("foo"), result);
+    QTRY_VERIFY(result.done);
+    QVERIFY2(result.error.contains(QStringLiteral("Too many package names.")), qPrintable(result.error));
+}
+
+void TestAurClient::httpError() {
+    aur->status = 503;
+    QStringList names;
+    for (int i = 0; i < 300; ++i) {
+        names.append(QStringLiteral("package-%1").arg(i));
+    }
+    AurClient client(aur->rpcUrl());
+    Result result;
+    query(client, names, result);
+    QTRY_VERIFY(result.done);
+    QVERIFY(!result.error.isEmpty());
+    // The lookup stops at the failed batch
+    QCOMPARE(aur->requests.size(), 1);
+}
+
+void TestAurClient::srcInfo() {
+    aur->srcInfo = "pkgbase = foo-git\n\tsource = foo::git+https://example.org/foo.git#branch=main\n";
+    AurClient client(aur->rpcUrl());
+    bool done = false;
+    QString text;
+    QString error;
+    client.fetchSrcInfo(QStringLiteral("foo-git"), [&](const QString& srcInfoText, const QString& fetchError) {
+        done = true;
+        text = srcInfoText;
+        error = fetchError;
+    });
+    QTRY_VERIFY(done);
+    QCOMPARE(error, QString());
+    QCOMPARE(text, QString::fromUtf8(aur->srcInfo));
+    QCOMPARE(aur->requests.size(), 1);
+    QCOMPARE(aur->requests[0].method, QByteArray("GET"));
+    QCOMPARE(aur->requests[0].target, QByteArray("/cgit/aur.git/plain/.SRCINFO?h=foo-git"));
+}
+
+QTEST_GUILESS_MAIN(TestAurClient)
+#include "test_aur_client.moc"
@@ -0,0 +1,232 @@
+#include "check_gate.h"
+#include "check_scheduler.h"
+#include "system_events.h"
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QDBusMessage>
+#include <QDBusVariant>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QThread>
+
+#include <memory>
+
+// Stand-ins for the properties the gate reads from UPower and
+// NetworkManager, served from their own thread and connection like the real
+// services. Changes are announced with PropertiesChanged, which is all
+// SystemEvents listens to after its first asynchronous Get.
+class UPowerStandIn : public QObject {
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.freedesktop.UPower")
+    Q_PROPERTY(bool OnBattery MEMBER onBattery)
+
+public:
+    bool onBattery = false;
+};
+
+class NetworkManagerStandIn : public QObject {
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.freedesktop.NetworkManager")
+    Q_PROPERTY(uint Metered MEMBER metered)
+
+public:
+    uint metered = 0; // NM_METERED_UNKNOWN
+};
+
+class TestCheckGate : public QObject {
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void idle();
+    void pressure_data();
+    void pressure();
+    void battery();
+    void metered();
+    void deferralBound();
+
+private:
+    void writePressure(const QString& resource, double avg60);
+    void setOnBattery(bool onBattery);
+    void setMetered(uint metered);
+    CheckGate gate(bool deferOnBattery = true, bool deferOnMetered = true) const;
+
+    QTemporaryDir pressureDir;
+    QThread serviceThread;
+    UPowerStandIn* upower = nullptr;
+    NetworkManagerStandIn* networkManager = nullptr;
+    std::unique_ptr<SystemEvents> events;
+    bool busAvailable = false;
+};
+
+void TestCheckGate::initTestCase() {
+    QVERIFY(pressureDir.isValid());
+    if (!QDBusConnection::sessionBus().isConnected()) {
+        events = std::make_unique<SystemEvents>(QDBusConnection::sessionBus());
+        return; // Battery and metered cases are skipped
+    }
+    QDBusConnection services = QDBusConnection::connectToBus(QDBusConnection::SessionBus, QStringLiteral("stand-ins"));
+    upower = new UPowerStandIn;
+    networkManager = new NetworkManagerStandIn;
+    upower->moveToThread(&serviceThread);
+    networkManager->moveToThread(&serviceThread);
+    serviceThread.start();
+    QVERIFY(services.registerObject(QStringLiteral("/org/freedesktop/UPower"), upower,
+                                    QDBusConnection::ExportAllProperties));
+    QVERIFY(services.registerObject(QStringLiteral("/org/freedesktop/NetworkManager"), networkManager,
+                                    QDBusConnection::ExportAllProperties));
+    QVERIFY(services.registerService(QStringLiteral("org.freedesktop.UPower")));
+    QVERIFY(services.registerService(QStringLiteral("org.freedesktop.NetworkManager")));
+    busAvailable = true;
+    events = std::make_unique<SystemEvents>(QDBusConnection::sessionBus());
+}
+
+void TestCheckGate::cleanupTestCase() {
+    events.reset();
+    serviceThread.quit();
+    serviceThread.wait();
+    delete upower;
+    delete networkManager;
+    QDBusConnection::disconnectFromBus(QStringLiteral("stand-ins"));
+}
+
+void TestCheckGate::init() {
+    for (const QString& resource : {QStringLiteral("cpu"), QStringLiteral("io"), QStringLiteral("memory")}) {
+        QFile::remove(pressureDir.filePath(resource));
+    }
+    if (busAvailable) {
+        setOnBattery(false);
+        setMetered(0);
+        QTRY_VERIFY(!events->onBattery() && !events->isMetered());
+    }
+}
+
+void TestCheckGate::setOnBattery(bool onBattery) {
+    upower->onBattery = onBattery;
+    QDBusMessage changed = QDBusMessage::createSignal(QStringLiteral("/org/freedesktop/UPower"),
+                                                      QStringLiteral("org.freedesktop.DBus.Properties"),
+                                                      QStringLiteral("PropertiesChanged"));
+    changed << QStringLiteral("org.freedesktop.UPower")
+            << QVariantMap{{QStringLiteral("OnBattery"), onBattery}} << QStringList();
+    QVERIFY(QDBusConnection(QStringLiteral("stand-ins")).send(changed));
+}
+
+void TestCheckGate::setMetered(uint metered) {
+    networkManager->metered = metered;
+    QDBusMessage changed = QDBusMessage::createSignal(QStringLiteral("/org/freedesktop/NetworkManager"),
+                                                      QStringLiteral("org.freedesktop.DBus.Properties"),
+                                                      QStringLiteral("PropertiesChanged"));
+    changed << QStringLiteral("org.freedesktop.NetworkManager")
+            << QVariantMap{{QStringLiteral("Metered"), metered}} << QStringList();
+    QVERIFY(QDBusConnection(QStringLiteral("stand-ins")).send(changed));
+}
+
+void TestCheckGate::writePressure(const QString& resource, double avg60) {
+    QFile file(pressureDir.filePath(resource));
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(QStringLiteral("some avg10=0.00 avg60=%1 avg300=0.00 total=1234\n"
+                              "full avg10=0.00 avg60=0.00 avg300=0.00 total=0\n")
+                   .arg(avg60, 0, 'f', 2)
+                   .toLatin1());
+}
+
+CheckGate TestCheckGate::gate(bool deferOnBattery, bool deferOnMetered) const {
+    return CheckGate(40, 20, 10, deferOnBattery, deferOnMetered, pressureDir.path(), events.get());
+}
+
+void TestCheckGate::idle() {
+    // No PSI files (kernel without PSI) and nothing on battery or metered
+    QCOMPARE(gate().deferReason(), QString());
+    writePressure(QStringLiteral("cpu"), 5);
+    writePressure(QStringLiteral("io"), 1);
+    writePressure(QStringLiteral("memory"), 0);
+    QCOMPARE(gate().deferReason(), QString());
+}
+
+void TestCheckGate::pressure_data() {
+    QTest::addColumn<QString>("resource");
+    QTest::addColumn<double>("avg60");
+    QTest::addColumn<bool>("deferred");
+
+    QTest::newRow("cpu below") << QStringLiteral("cpu") << 39.9 << false;
+    QTest::newRow("cpu above") << QStringLiteral("cpu") << 40.5 << true;
+    QTest::newRow("io above") << QStringLiteral("io") << 25.0 << true;
+    QTest::newRow("memory at limit") << QStringLiteral("memory") << 10.0 << false;
+    QTest::newRow("memory above") << QStringLiteral("memory") << 12.0 << true;
+}
+
+void TestCheckGate::pressure() {
+    QFETCH(QString, resource);
+    QFETCH(double, avg60);
+    QFETCH(bool, deferred);
+    writePressure(resource, avg60);
+    const QString reason = gate().deferReason();
+    QCOMPARE(!reason.isEmpty(), deferred);
+    if (deferred) {
+        QVERIFY2(reason.startsWith(resource + QStringLiteral(" pressure")), qPrintable(reason));
+    }
+
+    // A limit of 0 disables the resource
+    const CheckGate disabled(0, 0, 0, false, false, pressureDir.path(), events.get());
+    QCOMPARE(disabled.deferReason(), QString());
+}
+
+void TestCheckGate::battery() {
+    if (!busAvailable) {
+        QSKIP("No session bus");
+    }
+    setOnBattery(true);
+    QTRY_COMPARE(gate().deferReason(), QStringLiteral("on battery"));
+    QCOMPARE(gate(false).deferReason(), QString());
+
+    // The first value is fetched when SystemEvents starts
+    SystemEvents started(QDBusConnection::sessionBus());
+    QTRY_VERIFY(started.onBattery());
+}
+
+void TestCheckGate::metered() {
+    if (!busAvailable) {
+        QSKIP("No session bus");
+    }
+    setMetered(1); // NM_METERED_YES
+    QTRY_COMPARE(gate().deferReason(), QStringLiteral("metered connection"));
+    setMetered(4); // NM_METERED_GUESS_NO
+    QTRY_COMPARE(gate().deferReason(), QString());
+    setMetered(3); // NM_METERED_GUESS_YES
+    QTRY_COMPARE(gate().deferReason(), QStringLiteral("metered connection"));
+    QCOMPARE(gate(true, false).deferReason(), QString());
+
+    // No events at all: nothing to defer on
+    const CheckGate unknown(40, 20, 10, true, true, pressureDir.path(), nullptr);
+    QCOMPARE(unknown.deferReason(), QString());
+}
+
+void TestCheckGate::deferralBound() {
+    // Deferrals retry every ten minutes, but not past one base interval
+    CheckScheduler scheduler(3600);
+    const qint64 start = 1000000;
+    scheduler.recordCheck(start, false);
+    const qint64 due = scheduler.nextCheckAt();
+    QVERIFY(!scheduler.isDeferralExhausted(due));
+    qint64 now = due;
+    while (!scheduler.isDeferralExhausted(now)) {
+        scheduler.recordDeferral(now);
+        QCOMPARE(scheduler.nextCheckAt(), now + 600);
+        now = scheduler.nextCheckAt();
+        QVERIFY(now - due <= 3600);
+    }
+    QCOMPARE(now - due, qint64(3600));
+
+    // Persisted across a restart, cleared by the next check
+    CheckScheduler restored(3600);
+    restored.restore(scheduler.toJson(), start);
+    QVERIFY(restored.isDeferralExhausted(now));
+    restored.recordCheck(now, false);
+    QVERIFY(!restored.isDeferralExhausted(now));
+}
+
+QTEST_GUILESS_MAIN(TestCheckGate)
+#include "test_check_gate.moc"
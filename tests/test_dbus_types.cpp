@@ -0,0 +1,172 @@
+#include "dbus_types.h"
+#include <QDBusConnection>
+#include <QDBusInterface>
+#include <QDBusMetaType>
+#include <QDBusReply>
+#include <QFile>
+#include <QTest>
+#include <QThread>
+#include <QXmlStreamReader>
+
+// Serves the typed methods like the monitor does, from its own thread and
+// connection so blocking calls from the test can be answered
+class TypedService : public QObject {
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.mxlinux.UpdateNotifierSystemMonitor")
+
+public:
+    UpdateSummary summary;
+    QList<PackageRow> rows;
+
+public Q_SLOTS:
+    UpdateSummary GetSummary() { return summary; }
+    QList<PackageRow> GetPackages(uint offset, uint limit) {
+        if (offset >= static_cast<uint>(rows.size())) {
+            return QList<PackageRow>();
+        }
+        return rows.mid(offset, limit == 0 ? -1 : static_cast<qsizetype>(limit));
+    }
+};
+
+class TestDBusTypes : public QObject {
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void signatures();
+    void introspectionXml();
+    void summaryRoundTrip();
+    void packagesRoundTrip();
+
+private:
+    QDBusInterface* client();
+
+    QThread serviceThread;
+    TypedService* service = nullptr;
+    QString serviceName;
+};
+
+void TestDBusTypes::initTestCase() {
+    registerDBusTypes();
+    if (!QDBusConnection::sessionBus().isConnected()) {
+        return; // Round trips are skipped
+    }
+    QDBusConnection connection = QDBusConnection::connectToBus(QDBusConnection::SessionBus, QStringLiteral("service"));
+    service = new TypedService;
+    service->moveToThread(&serviceThread);
+    serviceThread.start();
+    QVERIFY(connection.registerObject(QStringLiteral("/org/mxlinux/UpdateNotifierSystemMonitor"), service,
+                                      QDBusConnection::ExportAllSlots));
+    serviceName = connection.baseService();
+}
+
+void TestDBusTypes::cleanupTestCase() {
+    serviceThread.quit();
+    serviceThread.wait();
+    delete service;
+    QDBusConnection::disconnectFromBus(QStringLiteral("service"));
+}
+
+QDBusInterface* TestDBusTypes::client() {
+    auto* interface = new QDBusInterface(serviceName, QStringLiteral("/org/mxlinux/UpdateNotifierSystemMonitor"),
+                                         QStringLiteral("org.mxlinux.UpdateNotifierSystemMonitor"),
+                                         QDBusConnection::sessionBus(), this);
+    interface->setTimeout(5000);
+    return interface;
+}
+
+void TestDBusTypes::signatures() {
+    QCOMPARE(QString::fromLatin1(QDBusMetaType::typeToSignature(QMetaType::fromType<UpdateSummary>())),
+             QStringLiteral("(iiiiiix)"));
+    QCOMPARE(QString::fromLatin1(QDBusMetaType::typeToSignature(QMetaType::fromType<PackageRow>())),
+             QStringLiteral("(ssss)"));
+    QCOMPARE(QString::fromLatin1(QDBusMetaType::typeToSignature(QMetaType::fromType<QList<PackageRow>>())),
+             QStringLiteral("a(ssss)"));
+}
+
+void TestDBusTypes::introspectionXml() {
+    // The checked-in description must match what the types marshal to
+    QFile file(QStringLiteral(INTROSPECTION_XML));
+    QVERIFY2(file.open(QIODevice::ReadOnly), qPrintable(file.fileName()));
+    QHash<QString, QString> outTypes; // Method -> out signature
+    QXmlStreamReader xml(&file);
+    QString method;
+    while (!xml.atEnd()) {
+        if (!xml.readNextStartElement()) {
+            continue;
+        }
+        const QXmlStreamAttributes attributes = xml.attributes();
+        if (xml.name() == QStringLiteral("method")) {
+            method = attributes.value(QStringLiteral("name")).toString();
+        } else if (xml.name() == QStringLiteral("signal")) {
+            method.clear();
+        } else if (xml.name() == QStringLiteral("arg") && !method.isEmpty() && attributes.value(QStringLiteral("direction")) == QStringLiteral("out")) {
+            outTypes.insert(method, attributes.value(QStringLiteral("type")).toString());
+        }
+    }
+    QVERIFY2(!xml.hasError(), qPrintable(xml.errorString()));
+    QCOMPARE(outTypes.value(QStringLiteral("GetSummary")),
+             QString::fromLatin1(QDBusMetaType::typeToSignature(QMetaType::fromType<UpdateSummary>())));
+    QCOMPARE(outTypes.value(QStringLiteral("GetPackages")),
+             QString::fromLatin1(QDBusMetaType::typeToSignature(QMetaType::fromType<QList<PackageRow>>())));
+    QCOMPARE(outTypes.value(QStringLiteral("GetStateSummary")), QStringLiteral("s"));
+}
+
+void TestDBusTypes::summaryRoundTrip() {
+    if (!service) {
+        QSKIP("No session bus");
+    }
+    service->summary = UpdateSummary{12, 3, 15, 1, 2, 4, Q_INT64_C(1760000000123)};
+    QDBusReply<UpdateSummary> reply = client()->call(QStringLiteral("GetSummary"));
+    QVERIFY2(reply.isValid(), qPrintable(reply.error().message()));
+    const UpdateSummary summary = reply.value();
+    QCOMPARE(summary.upgrade, 12);
+    QCOMPARE(summary.aurUpgrade, 3);
+    QCOMPARE(summary.totalUpgrade, 15);
+    QCOMPARE(summary.remove, 1);
+    QCOMPARE(summary.held, 2);
+    QCOMPARE(summary.devel, 4);
+    QCOMPARE(summary.checkedAt, Q_INT64_C(1760000000123));
+}
+
+void TestDBusTypes::packagesRoundTrip() {
+    if (!service) {
+        QSKIP("No session bus");
+    }
+    service->rows = {
+        PackageRow{QStringLiteral("linux"), QStringLiteral("6.9.1.arch1-1"), QStringLiteral("6.9.2.arch1-1"),
+                   QStringLiteral("core")},
+        PackageRow{QStringLiteral("libc++"), QStringLiteral("1:17.0-1"), QStringLiteral("1:18.0-1"),
+                   QStringLiteral("extra")},
+        PackageRow{QStringLiteral("yay"), QStringLiteral("12.3.0-1"), QStringLiteral("12.3.1-1"),
+                   QStringLiteral("aur")},
+        PackageRow{QStringLiteral("ünïcode"), QString(), QStringLiteral("1-1"), QStringLiteral("aur")},
+    };
+    QDBusInterface* interface = client();
+
+    QDBusReply<QList<PackageRow>> all = interface->call(QStringLiteral("GetPackages"), 0u, 0u);
+    QVERIFY2(all.isValid(), qPrintable(all.error().message()));
+    QCOMPARE(all.value().size(), service->rows.size());
+    for (qsizetype i = 0; i < service->rows.size(); ++i) {
+        const PackageRow& sent = service->rows.at(i);
+        const PackageRow& received = all.value().at(i);
+        QCOMPARE(received.name, sent.name);
+        QCOMPARE(received.oldVersion, sent.oldVersion);
+        QCOMPARE(received.newVersion, sent.newVersion);
+        QCOMPARE(received.repository, sent.repository);
+    }
+
+    QDBusReply<QList<PackageRow>> page = interface->call(QStringLiteral("GetPackages"), 1u, 2u);
+    QVERIFY(page.isValid());
+    QCOMPARE(page.value().size(), 2);
+    QCOMPARE(page.value().at(0).name, QStringLiteral("libc++"));
+    QCOMPARE(page.value().at(1).name, QStringLiteral("yay"));
+
+    QDBusReply<QList<PackageRow>> past = interface->call(QStringLiteral("GetPackages"), 10u, 5u);
+    QVERIFY(past.isValid());
+    QVERIFY(past.value().isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TestDBusTypes)
+#include "test_dbus_types.moc"
@@ -0,0 +1,227 @@
+#include "devel_check_job.h"
+#include <QDebug>
+#include <QProcess>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QUrl>
+
+// DevelCheckJob against local bare git repositories (file:// URLs), plus
+// the .SRCINFO source parsing it relies on
+class TestDevelCheckJob : public QObject {
+    Q_OBJECT
+
+private Q_SLOTS:
+    void parse_data();
+    void parse();
+    void fromSrcInfo();
+    void initTestCase();
+    void branchAndTag();
+    void skipped();
+    void unreachable();
+    void parallel();
+
+private:
+    bool git(const QStringList& args, const QString& workingDir, QString* output = nullptr);
+    QString fileUrl(const QString& repo) const;
+    void check(const QHash<QString, DevelSource>& sources, QHash<QString, QString>& revisions, int maxParallel = 4,
+               const QStringList& allowed = {QStringLiteral("file")});
+
+    QTemporaryDir dir;
+    QString upstream;
+    QString mainHead;
+    QString devHead;
+    QString tagged;
+};
+
+void TestDevelCheckJob::parse_data() {
+    QTest::addColumn<QString>("source");
+    QTest::addColumn<bool>("valid");
+    QTest::addColumn<QString>("vcs");
+    QTest::addColumn<QString>("url");
+    QTest::addColumn<QString>("fragmentType");
+    QTest::addColumn<QString>("fragment");
+
+    QTest::newRow("git https") << QStringLiteral("git+https://example.org/foo.git") << true << QStringLiteral("git")
+                               << QStringLiteral("https://example.org/foo.git") << QString() << QString();
+    QTest::newRow("renamed branch") << QStringLiteral("foo::git+https://example.org/foo.git#branch=dev") << true
+                                    << QStringLiteral("git") << QStringLiteral("https://example.org/foo.git")
+                                    << QStringLiteral("branch") << QStringLiteral("dev");
+    QTest::newRow("bare git url") << QStringLiteral("git://example.org/foo.git") << true << QStringLiteral("git")
+                                  << QStringLiteral("git://example.org/foo.git") << QString() << QString();
+    QTest::newRow("signed tag") << QStringLiteral("git+https://example.org/foo.git?signed#tag=v1.0") << true
+                                << QStringLiteral("git") << QStringLiteral("https://example.org/foo.git")
+                                << QStringLiteral("tag") << QStringLiteral("v1.0");
+    QTest::newRow("hg") << QStringLiteral("hg+https://example.org/repo") << true << QStringLiteral("hg")
+                        << QStringLiteral("https://example.org/repo") << QString() << QString();
+    QTest::newRow("svn revision") << QStringLiteral("svn+https://example.org/svn/trunk#revision=42") << true
+                                  << QStringLiteral("svn") << QStringLiteral("https://example.org/svn/trunk")
+                                  << QStringLiteral("revision") << QStringLiteral("42");
+    QTest::newRow("tarball") << QStringLiteral("https://example.org/foo-1.0.tar.gz") << false << QString()
+                             << QString() << QString() << QString();
+    QTest::newRow("bzr") << QStringLiteral("bzr+https://example.org/foo") << false << QString() << QString()
+                         << QString() << QString();
+}
+
+void TestDevelCheckJob::parse() {
+    QFETCH(QString, source);
+    QFETCH(bool, valid);
+    const std::optional<DevelSource> parsed = DevelSource::parse(source);
+    QCOMPARE(parsed.has_value(), valid);
+    if (!valid) {
+        return;
+    }
+    QTEST(parsed->vcs, "vcs");
+    QTEST(parsed->url, "url");
+    QTEST(parsed->fragmentType, "fragmentType");
+    QTEST(parsed->fragment, "fragment");
+}
+
+void TestDevelCheckJob::fromSrcInfo() {
+    const QString srcInfo = QStringLiteral("pkgbase = foo-git\n"
+                                           "\tpkgver = 1.0.r10.gabcdef0\n"
+                                           "\tsource = foo.patch\n"
+                                           "\tsource_x86_64 = foo::git+https://example.org/foo.git#branch=dev\n"
+                                           "\tsource = bar::git+https://example.org/bar.git\n"
+                                           "\n"
+                                           "pkgname = foo-git\n");
+    QCOMPARE(DevelSource::fromSrcInfo(srcInfo), QStringLiteral("foo::git+https://example.org/foo.git#branch=dev"));
+    QCOMPARE(DevelSource::fromSrcInfo(QStringLiteral("pkgbase = foo\n\tsource = foo-1.0.tar.gz\n")), QString());
+
+    DevelSource pinned = *DevelSource::parse(QStringLiteral("git+https://example.org/foo.git#commit=abc"));
+    QVERIFY(pinned.isPinned());
+    QCOMPARE(pinned.scheme(), QStringLiteral("https"));
+    DevelSource scp = *DevelSource::parse(QStringLiteral("git+git@example.org:foo.git"));
+    QVERIFY(!scp.isPinned());
+    QCOMPARE(scp.scheme(), QStringLiteral("ssh"));
+}
+
+bool TestDevelCheckJob::git(const QStringList& args, const QString& workingDir, QString* output) {
+    QProcess process;
+    process.setWorkingDirectory(workingDir);
+    process.start(QStringLiteral("git"), QStringList() << QStringLiteral("-c") << QStringLiteral("user.name=Test")
+                                                       << QStringLiteral("-c")
+                                                       << QStringLiteral("user.email=test@example.org") << args);
+    if (!process.waitForFinished() || process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+        qWarning() << "git" << args << "failed:" << process.readAllStandardError();
+        return false;
+    }
+    if (output) {
+        *output = QString::fromUtf8(process.readAllStandardOutput()).trimmed();
+    }
+    return true;
+}
+
+QString TestDevelCheckJob::fileUrl(const QString& repo) const {
+    return QStringLiteral("git+") + QUrl::fromLocalFile(repo).toString();
+}
+
+void TestDevelCheckJob::initTestCase() {
+    if (QStandardPaths::findExecutable(QStringLiteral("git")).isEmpty()) {
+        QSKIP("git is not installed");
+    }
+    QVERIFY(dir.isValid());
+    // main: first (tagged v1.0) <- second; dev: second <- third
+    upstream = dir.filePath(QStringLiteral("upstream.git"));
+    const QString work = dir.filePath(QStringLiteral("work"));
+    const QString head = QStringLiteral("HEAD");
+    QVERIFY(git({QStringLiteral("init"), QStringLiteral("--bare"), upstream}, dir.path()));
+    QVERIFY(git({QStringLiteral("symbolic-ref"), head, QStringLiteral("refs/heads/main")}, upstream));
+    QVERIFY(git({QStringLiteral("init"), work}, dir.path()));
+    QVERIFY(git({QStringLiteral("checkout"), QStringLiteral("-b"), QStringLiteral("main")}, work));
+    QVERIFY(git({QStringLiteral("commit"), QStringLiteral("--allow-empty"), QStringLiteral("-m"),
+                 QStringLiteral("first")},
+                work));
+    QVERIFY(git({QStringLiteral("tag"), QStringLiteral("v1.0")}, work));
+    QVERIFY(git({QStringLiteral("rev-parse"), head}, work, &tagged));
+    QVERIFY(git({QStringLiteral("commit"), QStringLiteral("--allow-empty"), QStringLiteral("-m"),
+                 QStringLiteral("second")},
+                work));
+    QVERIFY(git({QStringLiteral("rev-parse"), head}, work, &mainHead));
+    QVERIFY(git({QStringLiteral("checkout"), QStringLiteral("-b"), QStringLiteral("dev")}, work));
+    QVERIFY(git({QStringLiteral("commit"), QStringLiteral("--allow-empty"), QStringLiteral("-m"),
+                 QStringLiteral("third")},
+                work));
+    QVERIFY(git({QStringLiteral("rev-parse"), head}, work, &devHead));
+    QVERIFY(git({QStringLiteral("push"), upstream, QStringLiteral("main"), QStringLiteral("dev"),
+                 QStringLiteral("v1.0")},
+                work));
+    QVERIFY(!tagged.isEmpty() && !mainHead.isEmpty() && !devHead.isEmpty());
+    QVERIFY(tagged != mainHead && mainHead != devHead);
+}
+
+void TestDevelCheckJob::check(const QHash<QString, DevelSource>& sources, QHash<QString, QString>& revisions,
+                              int maxParallel, const QStringList& allowed) {
+    DevelCheckJob job(sources, maxParallel, allowed);
+    connect(&job, &DevelCheckJob::revisionFound, this,
+            [&revisions](const QString& package, const QString& revision) { revisions.insert(package, revision); });
+    QSignalSpy finished(&job, &DevelCheckJob::finished);
+    job.start();
+    if (finished.isEmpty()) {
+        QVERIFY(finished.wait(30000));
+    }
+    QCOMPARE(finished.size(), 1);
+    QVERIFY(!job.isActive());
+}
+
+void TestDevelCheckJob::branchAndTag() {
+    QHash<QString, DevelSource> sources;
+    sources.insert(QStringLiteral("head-git"), *DevelSource::parse(fileUrl(upstream)));
+    sources.insert(QStringLiteral("dev-git"), *DevelSource::parse(fileUrl(upstream) + QStringLiteral("#branch=dev")));
+    sources.insert(QStringLiteral("tag-git"), *DevelSource::parse(fileUrl(upstream) + QStringLiteral("#tag=v1.0")));
+    QHash<QString, QString> revisions;
+    check(sources, revisions);
+    QCOMPARE(revisions.size(), 3);
+    QCOMPARE(revisions.value(QStringLiteral("head-git")), mainHead);
+    QCOMPARE(revisions.value(QStringLiteral("dev-git")), devHead);
+    QCOMPARE(revisions.value(QStringLiteral("tag-git")), tagged);
+}
+
+void TestDevelCheckJob::skipped() {
+    // Pinned sources never change; schemes outside the allowlist are not
+    // contacted (and git refuses them through GIT_ALLOW_PROTOCOL as well)
+    QHash<QString, DevelSource> sources;
+    sources.insert(QStringLiteral("pinned-git"),
+                   *DevelSource::parse(fileUrl(upstream) + QStringLiteral("#commit=") + mainHead));
+    sources.insert(QStringLiteral("remote-git"), *DevelSource::parse(QStringLiteral("git+https://example.invalid/x")));
+    sources.insert(QStringLiteral("ssh-git"), *DevelSource::parse(QStringLiteral("git+git@example.invalid:x.git")));
+    QHash<QString, QString> revisions;
+    check(sources, revisions);
+    QVERIFY(revisions.isEmpty());
+
+    QHash<QString, DevelSource> local;
+    local.insert(QStringLiteral("head-git"), *DevelSource::parse(fileUrl(upstream)));
+    check(local, revisions, 4, {QStringLiteral("https")});
+    QVERIFY(revisions.isEmpty());
+}
+
+void TestDevelCheckJob::unreachable() {
+    QHash<QString, DevelSource> sources;
+    sources.insert(QStringLiteral("missing-git"),
+                   *DevelSource::parse(fileUrl(dir.filePath(QStringLiteral("missing.git")))));
+    sources.insert(QStringLiteral("nobranch-git"),
+                   *DevelSource::parse(fileUrl(upstream) + QStringLiteral("#branch=nope")));
+    sources.insert(QStringLiteral("head-git"), *DevelSource::parse(fileUrl(upstream)));
+    QHash<QString, QString> revisions;
+    check(sources, revisions);
+    QCOMPARE(revisions.size(), 1);
+    QCOMPARE(revisions.value(QStringLiteral("head-git")), mainHead);
+}
+
+void TestDevelCheckJob::parallel() {
+    // More packages than slots: all are checked, one finished() at the end
+    QHash<QString, DevelSource> sources;
+    for (int i = 0; i < 10; ++i) {
+        sources.insert(QStringLiteral("pkg%1-git").arg(i), *DevelSource::parse(fileUrl(upstream)));
+    }
+    QHash<QString, QString> revisions;
+    check(sources, revisions, 3);
+    QCOMPARE(revisions.size(), 10);
+    for (const QString& revision : revisions) {
+        QCOMPARE(revision, mainHead);
+    }
+}
+
+QTEST_GUILESS_MAIN(TestDevelCheckJob)
+#include "test_devel_check_job.moc"
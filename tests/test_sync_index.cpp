@@ -0,0 +1,317 @@
+#include "sync_db.h"
+#include "sync_index.h"
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+#include <archive.h>
+#include <archive_entry.h>
+#include <cstring>
+
+// SyncIndex written from packages, mapped back and probed, and rejected
+// when the file is truncated or its header does not add up. The sync DBs
+// it is built from are written here as gzip tar archives like repo-add does.
+class TestSyncIndex : public QObject {
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+    void roundTrip();
+    void largeSet();
+    void reopen();
+    void diff();
+    void truncated();
+    void corruptHeader_data();
+    void corruptHeader();
+    void fullTable();
+    void readSyncDbs();
+    void unreadableRepo();
+    void pendingRemovals();
+
+private:
+    // Header field offsets, native layout as written by SyncIndex::write()
+    static constexpr qsizetype RECORD_COUNT_OFFSET = 12;
+    static constexpr qsizetype BUCKET_COUNT_OFFSET = 16;
+    static constexpr qsizetype BUCKETS_OFFSET_OFFSET = 88;
+
+    static SyncPackage package(const QString& name, const QString& version, const QString& repository);
+    void writeSyncDb(const QString& repo, const QList<SyncPackage>& packages);
+    void writeIndex(const QList<SyncPackage>& packages);
+    QByteArray readIndex() const;
+    void rewriteIndex(const QByteArray& data) const;
+
+    QTemporaryDir dir;
+    QString indexPath;
+};
+
+SyncPackage TestSyncIndex::package(const QString& name, const QString& version, const QString& repository) {
+    SyncPackage package;
+    package.name = name;
+    package.version = version;
+    package.repository = repository;
+    return package;
+}
+
+void TestSyncIndex::init() {
+    QVERIFY(dir.isValid());
+    indexPath = dir.filePath(QStringLiteral("sync-index.bin"));
+    QFile::remove(indexPath);
+}
+
+void TestSyncIndex::writeIndex(const QList<SyncPackage>& packages) {
+    QVERIFY(SyncIndex::write(indexPath, QStringLiteral("fingerprint"), packages));
+}
+
+QByteArray TestSyncIndex::readIndex() const {
+    QFile file(indexPath);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+void TestSyncIndex::rewriteIndex(const QByteArray& data) const {
+    QFile file(indexPath);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        file.write(data);
+    }
+}
+
+void TestSyncIndex::roundTrip() {
+    SyncPackage full = package(QStringLiteral("linux"), QStringLiteral("6.9.1-1"), QStringLiteral("core"));
+    full.description = QStringLiteral("The Linux kernel and modules");
+    full.fileName = QStringLiteral("linux-6.9.1-1-x86_64.pkg.tar.zst");
+    full.downloadSize = 140000000;
+    full.installedSize = 130000000;
+    full.groups = QStringList{QStringLiteral("base-kernels")};
+    full.depends = QStringList{QStringLiteral("coreutils"), QStringLiteral("kmod>=30")};
+    full.replaces = QStringList{QStringLiteral("linux-old")};
+    full.conflicts = QStringList{QStringLiteral("linux-fork<2")};
+    full.provides = QStringList{QStringLiteral("KSMBD-MODULE"), QStringLiteral("VIRTUALBOX-GUEST-MODULES")};
+    writeIndex({full, package(QStringLiteral("bash"), QStringLiteral("5.2.026-2"), QStringLiteral("core"))});
+
+    SyncIndex index;
+    QVERIFY(index.open(indexPath));
+    QCOMPARE(index.fingerprint(), QStringLiteral("fingerprint"));
+    QCOMPARE(index.size(), qsizetype(2));
+
+    const std::optional<SyncPackage> found = index.find(QStringLiteral("linux"));
+    QVERIFY(found);
+    QCOMPARE(found->toJson(), full.toJson());
+    QCOMPARE(index.version(QStringLiteral("bash")), QStringLiteral("5.2.026-2"));
+    QVERIFY(!index.find(QStringLiteral("zsh")));
+    QCOMPARE(index.version(QStringLiteral("zsh")), QString());
+    QCOMPARE(index.packages().size(), 2);
+}
+
+void TestSyncIndex::largeSet() {
+    // Enough names to collide in the hash table; every one is found, none
+    // of the misses is
+    QList<SyncPackage> packages;
+    for (int i = 0; i < 15000; ++i) {
+        packages.append(package(QStringLiteral("pkg-%1").arg(i), QStringLiteral("%1-1").arg(i),
+                                i % 2 ? QStringLiteral("extra") : QStringLiteral("core")));
+    }
+    // Packages in a later repository are shadowed by the first one
+    packages.append(package(QStringLiteral("pkg-0"), QStringLiteral("99-1"), QStringLiteral("testing")));
+    writeIndex(packages);
+
+    SyncIndex index;
+    QVERIFY(index.open(indexPath));
+    QCOMPARE(index.size(), qsizetype(15000));
+    for (int i = 0; i < 15000; ++i) {
+        QCOMPARE(index.version(QStringLiteral("pkg-%1").arg(i)), QStringLiteral("%1-1").arg(i));
+    }
+    QCOMPARE(index.find(QStringLiteral("pkg-0"))->repository, QStringLiteral("core"));
+    for (int i = 15000; i < 16000; ++i) {
+        QVERIFY(!index.find(QStringLiteral("pkg-%1").arg(i)));
+    }
+}
+
+void TestSyncIndex::reopen() {
+    writeIndex({package(QStringLiteral("bash"), QStringLiteral("5.2-1"), QStringLiteral("core"))});
+    SyncIndex index;
+    QVERIFY(index.open(indexPath));
+    // Replaced atomically while mapped; the old mapping stays valid
+    writeIndex({package(QStringLiteral("bash"), QStringLiteral("5.3-1"), QStringLiteral("core"))});
+    QCOMPARE(index.version(QStringLiteral("bash")), QStringLiteral("5.2-1"));
+    QVERIFY(index.open(indexPath));
+    QCOMPARE(index.version(QStringLiteral("bash")), QStringLiteral("5.3-1"));
+
+    index.close();
+    QVERIFY(!index.isOpen());
+    QCOMPARE(index.fingerprint(), QString());
+    QVERIFY(!index.find(QStringLiteral("bash")));
+    QVERIFY(!index.open(dir.filePath(QStringLiteral("missing.bin"))));
+}
+
+void TestSyncIndex::diff() {
+    writeIndex({package(QStringLiteral("bash"), QStringLiteral("5.2-1"), QStringLiteral("core")),
+                package(QStringLiteral("vim"), QStringLiteral("9.1-1"), QStringLiteral("extra")),
+                package(QStringLiteral("gone"), QStringLiteral("1.0-1"), QStringLiteral("extra"))});
+    SyncIndex index;
+    QVERIFY(index.open(indexPath));
+    const QSet<QString> changed = index.diff({package(QStringLiteral("bash"), QStringLiteral("5.2-1"), QStringLiteral("core")),
+                                              package(QStringLiteral("vim"), QStringLiteral("9.1-1"), QStringLiteral("core")),
+                                              package(QStringLiteral("new"), QStringLiteral("1.0-1"), QStringLiteral("extra"))});
+    QCOMPARE(changed, (QSet<QString>{QStringLiteral("vim"), QStringLiteral("new"), QStringLiteral("gone")}));
+}
+
+void TestSyncIndex::truncated() {
+    writeIndex({package(QStringLiteral("bash"), QStringLiteral("5.2-1"), QStringLiteral("core"))});
+    const QByteArray data = readIndex();
+    SyncIndex index;
+    for (const qsizetype size : {qsizetype(0), qsizetype(40), data.size() / 2, data.size() - 1}) {
+        rewriteIndex(data.left(size));
+        QVERIFY2(!index.open(indexPath), qPrintable(QString::number(size)));
+        QVERIFY(!index.isOpen());
+    }
+    rewriteIndex(data);
+    QVERIFY(index.open(indexPath));
+}
+
+void TestSyncIndex::corruptHeader_data() {
+    QTest::addColumn<qsizetype>("offset");
+    QTest::addColumn<quint64>("value");
+    QTest::addColumn<int>("size");
+
+    QTest::newRow("magic") << qsizetype(0) << quint64(0x58) << 1;
+    QTest::newRow("version") << qsizetype(8) << quint64(99) << 4;
+    QTest::newRow("bucket count not a power of two") << BUCKET_COUNT_OFFSET << quint64(24) << 4;
+    QTest::newRow("bucket count zero") << BUCKET_COUNT_OFFSET << quint64(0) << 4;
+    QTest::newRow("bucket table past the end") << BUCKET_COUNT_OFFSET << quint64(1u << 30) << 4;
+    QTest::newRow("records fill every bucket") << RECORD_COUNT_OFFSET << quint64(16) << 4;
+    QTest::newRow("bucket offset overflows") << BUCKETS_OFFSET_OFFSET << ~quint64(0) - 7 << 8;
+    QTest::newRow("bucket offset misaligned") << BUCKETS_OFFSET_OFFSET << quint64(121) << 8;
+}
+
+void TestSyncIndex::corruptHeader() {
+    QFETCH(qsizetype, offset);
+    QFETCH(quint64, value);
+    QFETCH(int, size);
+    writeIndex({package(QStringLiteral("bash"), QStringLiteral("5.2-1"), QStringLiteral("core"))});
+    QByteArray data = readIndex();
+    if (size == 8) {
+        std::memcpy(data.data() + offset, &value, sizeof(value));
+    } else if (size == 4) {
+        const quint32 narrow = static_cast<quint32>(value);
+        std::memcpy(data.data() + offset, &narrow, sizeof(narrow));
+    } else {
+        data[offset] = static_cast<char>(value);
+    }
+    rewriteIndex(data);
+    SyncIndex index;
+    QVERIFY(!index.open(indexPath));
+}
+
+void TestSyncIndex::fullTable() {
+    // Every bucket pointing at a record: valid header, but no empty bucket
+    // ends the probe. A miss has to stop after one pass over the table.
+    writeIndex({package(QStringLiteral("bash"), QStringLiteral("5.2-1"), QStringLiteral("core"))});
+    QByteArray data = readIndex();
+    quint32 bucketCount = 0;
+    quint64 bucketsOffset = 0;
+    std::memcpy(&bucketCount, data.constData() + BUCKET_COUNT_OFFSET, sizeof(bucketCount));
+    std::memcpy(&bucketsOffset, data.constData() + BUCKETS_OFFSET_OFFSET, sizeof(bucketsOffset));
+    QVERIFY(bucketCount > 1);
+    const quint32 first = 1;
+    for (quint32 i = 0; i < bucketCount; ++i) {
+        std::memcpy(data.data() + bucketsOffset + i * sizeof(quint32), &first, sizeof(first));
+    }
+    rewriteIndex(data);
+
+    SyncIndex index;
+    QVERIFY(index.open(indexPath));
+    QCOMPARE(index.version(QStringLiteral("bash")), QStringLiteral("5.2-1"));
+    QVERIFY(!index.find(QStringLiteral("zsh")));
+}
+
+void TestSyncIndex::writeSyncDb(const QString& repo, const QList<SyncPackage>& packages) {
+    QVERIFY(QDir(dir.path()).mkpath(QStringLiteral("sync")));
+    const QByteArray path = QFile::encodeName(dir.filePath(QStringLiteral("sync/") + repo + QStringLiteral(".db")));
+    archive* writer = archive_write_new();
+    archive_write_add_filter_gzip(writer);
+    archive_write_set_format_pax_restricted(writer);
+    QCOMPARE(archive_write_open_filename(writer, path.constData()), ARCHIVE_OK);
+    for (const SyncPackage& package : packages) {
+        QByteArray desc = "%NAME%\n" + package.name.toUtf8() + "\n\n%VERSION%\n" + package.version.toUtf8() + "\n\n";
+        if (!package.groups.isEmpty()) {
+            desc += "%GROUPS%\n" + package.groups.join(u'\n').toUtf8() + "\n\n";
+        }
+        const QByteArray name = (package.name + u'-' + package.version + QStringLiteral("/desc")).toUtf8();
+        archive_entry* entry = archive_entry_new();
+        archive_entry_set_pathname(entry, name.constData());
+        archive_entry_set_filetype(entry, AE_IFREG);
+        archive_entry_set_perm(entry, 0644);
+        archive_entry_set_size(entry, desc.size());
+        QCOMPARE(archive_write_header(writer, entry), ARCHIVE_OK);
+        QCOMPARE(archive_write_data(writer, desc.constData(), desc.size()), la_ssize_t(desc.size()));
+        archive_entry_free(entry);
+    }
+    archive_write_close(writer);
+    archive_write_free(writer);
+}
+
+void TestSyncIndex::readSyncDbs() {
+    SyncPackage grouped = package(QStringLiteral("xfce4-panel"), QStringLiteral("4.18.6-1"), QString());
+    grouped.groups = QStringList{QStringLiteral("xfce4")};
+    writeSyncDb(QStringLiteral("core"), {package(QStringLiteral("bash"), QStringLiteral("5.2-1"), QString())});
+    writeSyncDb(QStringLiteral("extra"), {grouped, package(QStringLiteral("bash"), QStringLiteral("5.3-1"), QString())});
+
+    QString error;
+    const QList<SyncPackage> packages =
+        ::readSyncDbs(dir.path(), QStringList{QStringLiteral("core"), QStringLiteral("extra")}, &error);
+    QCOMPARE(error, QString());
+    QCOMPARE(packages.size(), 3);
+    QCOMPARE(packages[0].repository, QStringLiteral("core"));
+
+    writeIndex(packages);
+    SyncIndex index;
+    QVERIFY(index.open(indexPath));
+    QCOMPARE(index.version(QStringLiteral("bash")), QStringLiteral("5.2-1"));
+    const std::optional<SyncPackage> found = index.find(QStringLiteral("xfce4-panel"));
+    QVERIFY(found);
+    QCOMPARE(found->repository, QStringLiteral("extra"));
+    QCOMPARE(found->groups, QStringList{QStringLiteral("xfce4")});
+}
+
+void TestSyncIndex::unreadableRepo() {
+    writeSyncDb(QStringLiteral("core"), {package(QStringLiteral("bash"), QStringLiteral("5.2-1"), QString())});
+    QFile broken(dir.filePath(QStringLiteral("sync/extra.db")));
+    QVERIFY(broken.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    broken.write("\x1f\x8b not really gzip");
+    broken.close();
+
+    // One unreadable database fails the whole read, so no index drops its packages
+    QString error;
+    QVERIFY(::readSyncDbs(dir.path(), QStringList{QStringLiteral("core"), QStringLiteral("extra")}, &error).isEmpty());
+    QVERIFY(!error.isEmpty());
+    error.clear();
+    QVERIFY(::readSyncDbs(dir.path(), QStringList{QStringLiteral("core"), QStringLiteral("missing")}, &error).isEmpty());
+    QVERIFY(!error.isEmpty());
+}
+
+void TestSyncIndex::pendingRemovals() {
+    // The new app conflicts with lib<2 and with plugin<3. lib is upgraded
+    // past the constraint, so it stays. plugin is not upgraded, so it goes.
+    SyncPackage app = package(QStringLiteral("app"), QStringLiteral("2.0-1"), QStringLiteral("extra"));
+    app.conflicts = QStringList{QStringLiteral("lib<2"), QStringLiteral("plugin<3")};
+    SyncPackage libNext = package(QStringLiteral("lib"), QStringLiteral("2.1-1"), QStringLiteral("extra"));
+    libNext.conflicts = QStringList{QStringLiteral("old-tool")};
+    SyncPackage fork = package(QStringLiteral("fork"), QStringLiteral("1.0-1"), QStringLiteral("extra"));
+    fork.replaces = QStringList{QStringLiteral("legacy<=1.5")};
+    const QHash<QString, QString> installed = {
+        {QStringLiteral("app"), QStringLiteral("1.0-1")}, {QStringLiteral("lib"), QStringLiteral("1.9-1")},
+        {QStringLiteral("plugin"), QStringLiteral("2.5-1")}, {QStringLiteral("old-tool"), QStringLiteral("1-1")},
+        {QStringLiteral("legacy"), QStringLiteral("1.4-1")}};
+    const QList<PendingRemoval> removals = findPendingRemovals(
+        {app, libNext, fork}, installed, QSet<QString>{QStringLiteral("app"), QStringLiteral("lib")});
+
+    QStringList found;
+    for (const PendingRemoval& removal : removals) {
+        found.append(removal.name + u':' + removal.reason + u':' + removal.by);
+    }
+    found.sort();
+    QCOMPARE(found, (QStringList{QStringLiteral("legacy:replaced:fork"), QStringLiteral("old-tool:conflict:lib"),
+                                 QStringLiteral("plugin:conflict:app")}));
+}
+
+QTEST_GUILESS_MAIN(TestSyncIndex)
+#include "test_sync_index.moc"
@@ -0,0 +1,126 @@
+#include "common.h"
+#include <QTest>
+
+// vercmp() against the cases of pacman's test/util/vercmptest.sh, each one
+// also checked with the arguments swapped
+class TestVercmp : public QObject {
+    Q_OBJECT
+
+private Q_SLOTS:
+    void compare_data();
+    void compare();
+    void batch();
+    void sort();
+};
+
+void TestVercmp::compare_data() {
+    QTest::addColumn<QString>("a");
+    QTest::addColumn<QString>("b");
+    QTest::addColumn<int>("expected");
+
+    const struct {
+        const char* a;
+        const char* b;
+        int expected;
+    } cases[] = {
+        // All similar length, no pkgrel
+        {"1.5.0", "1.5.0", 0},
+        {"1.5.1", "1.5.0", 1},
+        // Mixed length
+        {"1.5.1", "1.5", 1},
+        // With pkgrel, simple
+        {"1.5.0-1", "1.5.0-1", 0},
+        {"1.5.0-1", "1.5.0-2", -1},
+        {"1.5.0-1", "1.5.1-1", -1},
+        {"1.5.0-2", "1.5.1-1", -1},
+        // With pkgrel, mixed lengths
+        {"1.5-1", "1.5.1-1", -1},
+        {"1.5-2", "1.5.1-1", -1},
+        {"1.5-2", "1.5.1-2", -1},
+        // Mixed pkgrel inclusion
+        {"1.5", "1.5-1", 0},
+        {"1.5-1", "1.5", 0},
+        {"1.1-1", "1.1", 0},
+        {"1.0-1", "1.1", -1},
+        {"1.1-1", "1.0", 1},
+        // Alphanumeric versions
+        {"1.5b-1", "1.5-1", -1},
+        {"1.5b", "1.5", -1},
+        {"1.5b-1", "1.5", -1},
+        {"1.5b", "1.5.1", -1},
+        // From the manpage
+        {"1.0a", "1.0alpha", -1},
+        {"1.0alpha", "1.0b", -1},
+        {"1.0b", "1.0beta", -1},
+        {"1.0beta", "1.0rc", -1},
+        {"1.0rc", "1.0", -1},
+        // Alpha-dotted versions
+        {"1.5.a", "1.5", 1},
+        {"1.5.b", "1.5.a", 1},
+        {"1.5.1", "1.5.b", 1},
+        // Alpha dots and dashes
+        {"1.5.b-1", "1.5.b", 0},
+        {"1.5-1", "1.5.b", -1},
+        // Same or similar content, differing separators
+        {"2.0", "2_0", 0},
+        {"2.0_a", "2_0.a", 0},
+        {"2.0a", "2.0.a", -1},
+        {"2___a", "2_a", 1},
+        // Epoch included version comparisons
+        {"0:1.0", "0:1.0", 0},
+        {"0:1.0", "0:1.1", -1},
+        {"1:1.0", "0:1.0", 1},
+        {"1:1.0", "0:1.1", 1},
+        {"1:1.0", "2:1.1", -1},
+        // Epoch and sometimes present pkgrel
+        {"1:1.0", "0:1.0-1", 1},
+        {"1:1.0-1", "0:1.1-1", 1},
+        // Epoch included on one version
+        {"0:1.0", "1.0", 0},
+        {"0:1.0", "1.1", -1},
+        {"0:1.1", "1.0", 1},
+        {"1:1.0", "1.0", 1},
+        {"1:1.0", "1.1", 1},
+        {"1:1.1", "1.1", 1},
+    };
+    for (const auto& c : cases) {
+        QTest::addRow("%s %s", c.a, c.b) << QString::fromLatin1(c.a) << QString::fromLatin1(c.b) << c.expected;
+    }
+}
+
+void TestVercmp::compare() {
+    QFETCH(QString, a);
+    QFETCH(QString, b);
+    QFETCH(int, expected);
+    QCOMPARE(vercmp(a, b), expected);
+    QCOMPARE(vercmp(b, a), -expected);
+}
+
+void TestVercmp::batch() {
+    const QString versions[] = {QStringLiteral("1.0-1"), QStringLiteral("1.0-2"), QStringLiteral("1:0.1-1"),
+                                QStringLiteral("2.0rc1-1"), QStringLiteral("2.0-1")};
+    const VersionPair pairs[] = {{versions[0], versions[1]}, {versions[2], versions[0]}, {versions[3], versions[4]},
+                                 {versions[4], versions[4]}};
+    int results[4];
+    vercmpBatch(pairs, results);
+    QCOMPARE(results[0], -1);
+    QCOMPARE(results[1], 1);
+    QCOMPARE(results[2], -1);
+    QCOMPARE(results[3], 0);
+}
+
+void TestVercmp::sort() {
+    const QString a = QStringLiteral("1:0.9-1");
+    const QString b = QStringLiteral("1.0rc-1");
+    const QString c = QStringLiteral("1.0-1");
+    const QString d = QStringLiteral("1.0-2");
+    QStringView versions[] = {a, d, b, c};
+    sortVersions(versions);
+    QCOMPARE(versions[0].toString(), b);
+    QCOMPARE(versions[1].toString(), c);
+    QCOMPARE(versions[2].toString(), d);
+    QCOMPARE(versions[3].toString(), a);
+}
+
+QTEST_GUILESS_MAIN(TestVercmp)
+#include "test_vercmp.moc"